@@ -0,0 +1,43 @@
+#ifndef INCLUDE_CSV_CLASSIFY_HPP_
+#define INCLUDE_CSV_CLASSIFY_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+#include <string>
+
+#include <csv/constants.hpp>
+
+namespace csv {
+
+  /* Delimiter and newline classification used by Linescan. Blocks of 64 bytes
+     are compared against both characters at once, yielding one bit mask per
+     character; positions are then extracted from the masks with tzcnt/lzcnt.
+     The widest instruction set supported by the CPU is picked at runtime. */
+  enum class Simd_Level
+    {
+     SCALAR, SSE2, AVX2
+    };
+
+  Simd_Level simd_level();
+  std::string str(Simd_Level level);
+
+  /* Scans [buf, buf + n) forward until the first newline. Appends
+     offset + position of every delimiter in front of it to out and returns
+     the position of the newline, or n if there is none. */
+  size_t find_fields(const char* buf, size_t n, char delimiter,
+		     std::vector<size_t>& out, size_t offset);
+  size_t find_fields(Simd_Level level, const char* buf, size_t n, char delimiter,
+		     std::vector<size_t>& out, size_t offset);
+
+  /* Scans [end - n, end) backward until the first newline. Appends the
+     distance end - p of every delimiter p behind it to out (closest first) and
+     returns the distance of the newline, or 0 if there is none. */
+  size_t rfind_fields(const char* end, size_t n, char delimiter,
+		      std::vector<size_t>& out);
+  size_t rfind_fields(Simd_Level level, const char* end, size_t n, char delimiter,
+		      std::vector<size_t>& out);
+
+}
+
+#endif
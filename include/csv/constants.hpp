@@ -8,6 +8,43 @@ namespace csv {
 
   inline const size_t STDOUT_SIZE = 65535;
   inline const size_t POLL_TIMEOUT = 100;
+  inline const size_t READAHEAD_BLOCKS = 4;
+  inline const size_t PARALLEL_CHUNK_SIZE = 1 << 26;
+  inline const size_t PARALLEL_CHUNKS_PER_THREAD = 4;
+  /* Bytes of an in-memory join table per row, besides its bytes and fields:
+     row and offset starts and the offset past the last field (20), two to
+     four slots (48), the chain (4), the Bloom filter (2), and the hashes and
+     order while the table is built (12) */
+  inline const size_t JOIN_ROW_MEMORY = 86;
+  inline const size_t JOIN_FIELD_MEMORY = 4;
+  // Bytes per row of the payloads of a join table besides their bytes: start and missing flag
+  inline const size_t JOIN_PAYLOAD_ROW_MEMORY = 9;
+  // Bytes at the start of a join input whose rows tell its rows and fields
+  inline const size_t JOIN_SAMPLE_SIZE = 1 << 20;
+  inline const size_t JOIN_MAX_PARTITIONS = 256;
+  // Partitions used when the size of the build side is not known in advance
+  inline const size_t JOIN_STREAM_PARTITIONS = 64;
+  // Rows per partition of a join table, so that its slots fit into L2 cache
+  inline const size_t JOIN_PARTITION_ROWS = 1 << 13;
+  inline const size_t JOIN_MAX_RADIX_PARTITIONS = 1 << 14;
+  // Size of the Bloom filter of a join table, which has about 1% false positives
+  inline const size_t JOIN_BLOOM_BITS_PER_KEY = 12;
+  // Sorted runs kept in memory when reading a stream without a memory budget
+  inline const size_t SORT_RUN_SIZE = 1 << 26;
+  // Sorted runs merged at once; more runs are merged in several passes
+  inline const size_t SORT_MERGE_FANIN = 64;
+  // HyperLogLog registers of 2^SKETCH_HLL_BITS bytes per column, about 1.6% error
+  inline const size_t SKETCH_HLL_BITS = 12;
+  // Count-Min sketch of SKETCH_CMS_DEPTH rows of counters per column for the top values
+  inline const size_t SKETCH_CMS_WIDTH = 1 << 10;
+  inline const size_t SKETCH_CMS_DEPTH = 4;
+  inline const size_t SKETCH_TOP = 5;
+  // Candidates per top value kept by a sketch, so that merged sketches find the values of the union
+  inline const size_t SKETCH_TOP_CANDIDATES = 8;
+  // Partitions of the groups spilled by groupby once they exceed the memory budget
+  inline const size_t GROUPBY_PARTITIONS = 64;
+  // Partitions of the rows left once the keys seen by uniq exceed the memory budget
+  inline const size_t UNIQ_PARTITIONS = 64;
   inline const char NL = '\n';
   
   
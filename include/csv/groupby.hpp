@@ -0,0 +1,135 @@
+#ifndef INCLUDE_CSV_GROUPBY_HPP_
+#define INCLUDE_CSV_GROUPBY_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+
+#include <csv/match.hpp>
+
+namespace csv {
+
+  enum class Agg_Type
+    {
+     COUNT, SUM, MIN, MAX, MEAN
+    };
+
+  std::string str(Agg_Type type);
+  // Parses the name of an aggregate as given by str
+  Agg_Type agg_type(const std::string& name);
+
+  // Aggregate of column col over the rows of a group; COUNT has no column
+  struct Aggregate {
+    Agg_Type type;
+    size_t col;
+  };
+
+  /* Groups of rows with equal fields in key_cols, with aggregates over each
+     group. Open addressing with linear probing; every slot stores the full
+     hash of its key, and keys are compared as bytes with the fields of a row,
+     so rows of existing groups cost no allocation. A new group copies its key
+     once into an arena, as the key fields joined by the delimiter, which is
+     also how it is printed. The aggregates of all groups are kept in flat
+     arrays with an entry per group and aggregate. Fields that are not numbers,
+     empty or missing ones included, are left out of sums, minima, maxima and
+     means; minima and maxima take -0 as 0. Sums and means add up integer
+     fields exactly, so they do not depend on the order of rows. Every group remembers the position
+     of its first row, so tables of separate parts of an input can be merged
+     and still print their groups in input order. */
+  class Group_Table {
+  private:
+    struct Slot {
+      uint64_t hash;
+      uint32_t group;
+    };
+
+    std::vector<size_t> _key_cols;
+    std::vector<Aggregate> _aggs;
+    char _delimiter;
+    size_t _max_key_col;
+
+    std::vector<Slot> _slots;
+    std::vector<char> _keys;
+    // Key of group g is _keys[_key_starts[g]] to _keys[_key_starts[g+1]]
+    std::vector<size_t> _key_starts;
+    std::vector<uint64_t> _hashes;
+    std::vector<uint64_t> _firsts;
+    std::vector<uint64_t> _rows;
+    /* Numbers aggregated and their aggregate, at g * _aggs.size() + a. Sums
+       keep their integers apart, in _integers. */
+    std::vector<uint64_t> _counts;
+    std::vector<double> _values;
+    std::vector<int64_t> _integers;
+
+    bool key_equals(uint32_t group, const Linescan& lscan) const;
+    // Group of key with hash h, created without rows if there is none yet
+    template<class Equals, class Append>
+    uint32_t find(uint64_t h, Equals equals, Append append, uint64_t first);
+    void grow();
+    // Adds n rows, first at position first, with the given aggregates to group g
+    void combine(uint32_t g, uint64_t first, uint64_t rows,
+		 const uint64_t* counts, const double* values, const int64_t* integers);
+
+  public:
+    Group_Table(const std::vector<size_t>& key_cols, const std::vector<Aggregate>& aggs,
+		char delimiter);
+
+    /* Adds the row last scanned by lscan. position orders the rows of an
+       input, e.g. their byte offsets. Throws if a key field is missing. */
+    void add(const Linescan& lscan, uint64_t position);
+    // Adds the groups of a table with the same keys and aggregates
+    void merge(const Group_Table& o);
+
+    size_t n_groups() const { return _hashes.size(); };
+    // Bytes held by the table
+    size_t memory() const;
+    void clear();
+
+    std::string_view key(size_t group) const {
+      return std::string_view(_keys.data() + _key_starts[group],
+			      _key_starts[group+1] - _key_starts[group]);
+    };
+    uint64_t rows(size_t group) const { return _rows[group]; };
+    // Aggregate a of a group as printed; empty if the group has no numbers for it
+    std::string value(size_t group, size_t a) const;
+
+    /* Writes the partial aggregates of every group, in binary, to one of
+       files picked by its hash. read adds the groups written by write. */
+    void write(const std::vector<FILE*>& files) const;
+    void read(FILE* f);
+
+    // Writes one row per group, in order of their first rows: key fields, then aggregates
+    void print(FILE* out = stdout) const;
+  };
+
+  /* Partial aggregates spilled from Group_Tables that outgrew their memory,
+     partitioned by key hash into temporary files. All partial aggregates of a
+     group end up in the same file, so each file can be aggregated on its own.
+     Tables on separate threads may spill concurrently. */
+  class Group_Spill {
+  private:
+    std::vector<FILE*> _files;
+    std::mutex _mutex;
+    bool _spilled;
+
+  public:
+    Group_Spill(size_t n_partitions);
+    ~Group_Spill();
+    Group_Spill(const Group_Spill&) = delete;
+    Group_Spill& operator=(const Group_Spill&) = delete;
+
+    // Writes the groups of table to the partitions and clears it
+    void spill(Group_Table& table);
+    bool spilled() const { return _spilled; };
+    size_t n_partitions() const { return _files.size(); };
+    // Partition p, rewound for reading after the last spill
+    FILE* partition(size_t p);
+  };
+
+}
+
+#endif
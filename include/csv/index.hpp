@@ -2,51 +2,163 @@
 #define INCLUDE_CSV_INDEX_HPP_
 
 #include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
 
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <memory>
 
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/serialization/vector.hpp>
-#include <boost/serialization/unordered_map.hpp>
-#include <boost/serialization/string.hpp>
-
 #include <csv/match.hpp>
 
 namespace csv {
 
+  inline const char INDEX_MAGIC[8] = {'T','A','B','I','D','X','\n','\0'};
+  inline const uint64_t INDEX_VERSION = 2;
+  inline const std::string INDEX_SUFFIX = ".tabidx";
+  // Lines between two absolute anchors of a dense index
+  inline const uint64_t INDEX_ANCHOR_STRIDE = 64;
+
+  /* Layout of an index file: this header, followed by the arrays
+     anchor_offsets[n_anchors] and, for dense indexes only,
+     anchor_starts[n_anchors], line_deltas[n_lines+1], start_deltas[n_lines+1]
+     and field_offsets[n_offsets], with n_anchors = n_lines / stride + 1.
+     Anchors are native 64 bit integers, everything else 32 bit.
+     The file can be mapped and used as is. */
+  struct Index_Header {
+    char magic[8];
+    uint64_t version;
+    uint64_t delimiter;
+    uint64_t csv_size;
+    int64_t csv_mtime_sec;
+    int64_t csv_mtime_nsec;
+    uint64_t n_lines;
+    uint64_t n_offsets;
+    uint64_t stride;
+    uint64_t sparse;
+  };
+
   class Index {
   private:
     FILE* _fd;
-    std::vector<std::vector<size_t>> _offsetss; 
-    std::vector<size_t> _line_offsets;
+    size_t _read_size;
+    char _delimiter;
+    bool _crnl;
+    uint64_t _csv_size;
+    int64_t _csv_mtime_sec;
+    int64_t _csv_mtime_nsec;
     std::unordered_map<std::string,size_t> _column_keys;
-    size_t _read_size; 
+
+    /* Line i (0 is the first line after the header) starts at byte
+       _anchor_offsets[i / _stride] + _line_deltas[i] of the CSV file. Its
+       Linescan offsets, without the leading 0, are _field_offsets[s] to
+       _field_offsets[e-1], where s is _anchor_starts[i / _stride] + _start_deltas[i]
+       and e the same for line i+1.
+       A sparse index only keeps _anchor_offsets and scans from the closest
+       anchor instead. The arrays either live in the vectors below or in a
+       mapped index file. */
+    std::vector<uint64_t> _anchor_offsets_data;
+    std::vector<uint64_t> _anchor_starts_data;
+    std::vector<uint32_t> _line_deltas_data;
+    std::vector<uint32_t> _start_deltas_data;
+    std::vector<uint32_t> _field_offsets_data;
+    void* _map;
+    size_t _map_size;
+    const uint64_t* _anchor_offsets;
+    const uint64_t* _anchor_starts;
+    const uint32_t* _line_deltas;
+    const uint32_t* _start_deltas;
+    const uint32_t* _field_offsets;
+    size_t _n_lines;
+    size_t _n_offsets;
+    size_t _stride;
+    bool _sparse;
+
+    // Mapping of the CSV file for random access to lines and fields
+    std::unique_ptr<Mmap_Buffer> _csv_buf;
+    const char* _csv;
+
+    // Scan state of a sparse index: the last line sought and the last line scanned
+    mutable std::unique_ptr<Linescan> _lscan;
+    mutable size_t _seek_line;
+    mutable size_t _seek_offset;
+    mutable size_t _scanned_line;
+
+    void read_columns();
+    void use_data();
+    void open_csv(const std::string& csv_path);
+    size_t field_start(size_t line_idx) const {
+      return _anchor_starts[line_idx / _stride] + _start_deltas[line_idx];
+    };
+    size_t seek(size_t line_idx) const;
+    const Linescan& scan(size_t line_idx) const;
 
   public:
-    
+
     Index(FILE* fd, size_t read_size) :
-      _fd { fd } , _read_size {read_size} {};
+      _fd { fd } , _read_size {read_size}, _delimiter {0}, _crnl {false},
+      _csv_size {0}, _csv_mtime_sec {0}, _csv_mtime_nsec {0},
+      _map {nullptr}, _map_size {0},
+      _anchor_offsets {nullptr}, _anchor_starts {nullptr},
+      _line_deltas {nullptr}, _start_deltas {nullptr}, _field_offsets {nullptr},
+      _n_lines {0}, _n_offsets {0}, _stride {INDEX_ANCHOR_STRIDE}, _sparse {false},
+      _csv {nullptr}, _seek_line {SIZE_MAX}, _seek_offset {0}, _scanned_line {SIZE_MAX} {};
     ~Index() {
+      if(_map != nullptr) munmap(_map, _map_size);
       fclose(_fd);
     }
-    
+
+    /* With sparse_stride > 0, only the start of every sparse_stride-th line
+       is kept; lookups then scan up to sparse_stride lines. With threads > 1,
+       newline-aligned ranges of the file are scanned in parallel. */
     static std::unique_ptr<Index> create(const std::string& csv_path, char delimiter,
-					 size_t read_size, size_t buffer_size,
-					 size_t offsets_size);
-
-    const std::vector<std::vector<size_t>>& offsetss() const { return _offsetss; };
-    const std::vector<size_t>& line_offsets() const { return _line_offsets; };
-    const char* field(size_t line_idx, size_t field_idx);
-    size_t field_size(size_t line_idx, size_t field_idx); 
-    
+					 size_t read_size, size_t offsets_size,
+					 size_t sparse_stride = 0,
+					 size_t threads = 1);
+    /* Maps the index file at index_path. Returns nullptr if it does not exist,
+       or does not match the current size and modification time of the CSV file. */
+    static std::unique_ptr<Index> load(const std::string& csv_path,
+				       const std::string& index_path,
+				       char delimiter, size_t read_size);
+    static std::string sidecar_path(const std::string& csv_path) {
+      return csv_path + INDEX_SUFFIX;
+    };
+
+    void save(const std::string& index_path) const;
+
+    size_t n_lines() const { return _n_lines; };
+    bool sparse() const { return _sparse; };
+    size_t csv_size() const { return _csv_size; };
+    const char* data() const { return _csv; };
+    // Valid for line_idx up to n_lines(), which yields the end of the data
+    size_t line_offset(size_t line_idx) const {
+      if(_sparse) return seek(line_idx);
+      return _anchor_offsets[line_idx / _stride] + _line_deltas[line_idx];
+    };
+    size_t n_fields(size_t line_idx) const {
+      if(_sparse) return scan(line_idx).n_fields();
+      return field_start(line_idx+1) - field_start(line_idx);
+    };
+    const std::unordered_map<std::string,size_t>& column_keys() const { return _column_keys; };
+    std::vector<std::vector<size_t>> offsetss() const;
+    std::vector<size_t> line_offsets() const;
+    /* Lines (including their newline) and fields are read from the mapped CSV
+       file without scanning, unless the index is sparse. Out of range indexes
+       yield nullptr and 0. A sparse index must not be shared between threads. */
+    const char* line(size_t line_idx) const;
+    size_t line_size(size_t line_idx) const;
+    const char* field(size_t line_idx, size_t field_idx) const;
+    size_t field_size(size_t line_idx, size_t field_idx) const;
+
     Index(const Index& o) = delete;
     Index& operator=(const Index& o) = delete;
   };
 
+  /* Parses a half-open range of data rows "A:B"; either bound may be left
+     out, "A" is A:A+1. Bounds are decimal digits only, anything else throws. */
+  void parse_row_range(const std::string& range, size_t& begin, size_t& end);
+
 
 }
 
@@ -0,0 +1,274 @@
+#ifndef INCLUDE_CSV_JOIN_HPP_
+#define INCLUDE_CSV_JOIN_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+
+#include <csv/match.hpp>
+
+namespace csv {
+
+  enum class Join_Mode
+    {
+     NATURAL, LEFT, RIGHT, FULL, SEMI, ANTI
+    };
+
+  // Input a join builds its hash table on; AUTO lets swap_join_sides decide
+  enum class Build_Side
+    {
+     AUTO, CSV_1, CSV_2
+    };
+
+  // Semi and anti joins only output the rows of csv_1
+  inline bool left_only(Join_Mode join_mode){
+    return join_mode == Join_Mode::SEMI || join_mode == Join_Mode::ANTI;
+  }
+
+  // Hash of a multi-column key; get(k) yields the k-th of n key fields
+  template<class Get>
+  uint64_t hash_key(size_t n, Get get){
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    for(size_t k=0;k<n;k++){
+      h ^= std::hash<std::string_view>{}(get(k));
+      h *= 0xFF51AFD7ED558CCDull;
+      h ^= h >> 33;
+    }
+    // 0 marks empty slots
+    return h == 0 ? 1 : h;
+  }
+
+  /* Split block Bloom filter over 64 bit key hashes. A key sets one bit in
+     each of the 8 words of a 256 bit block, so a lookup reads a single cache
+     line. The caller picks the block, from bits of the hash that are not
+     used for the bits within the block. */
+  class Bloom_Filter {
+  private:
+    struct alignas(32) Block {
+      uint32_t words[8];
+    };
+    std::vector<Block> _blocks;
+
+    static uint32_t bit(uint32_t key, size_t word) {
+      static const uint32_t SALTS[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+					0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+      return 1U << ((key * SALTS[word]) >> 27);
+    };
+
+  public:
+    Bloom_Filter(size_t n_blocks = 0) : _blocks (n_blocks, Block {}) {};
+
+    size_t n_blocks() const { return _blocks.size(); };
+    void add(size_t block, uint32_t key) {
+      for(size_t w=0;w<8;w++) _blocks[block].words[w] |= bit(key, w);
+    };
+    bool contains(size_t block, uint32_t key) const {
+      for(size_t w=0;w<8;w++)
+	if((_blocks[block].words[w] & bit(key, w)) == 0) return false;
+      return true;
+    };
+  };
+
+  /* Hash table over the rows of a Csv, keyed by the fields of key_cols.
+     Open addressing with linear probing; every slot stores the full hash of
+     its key, so most mismatches are rejected without comparing fields. Rows
+     with equal keys form a chain in file order, so a probe finds all of them.
+     The rows are radix partitioned by hash into tables of about
+     JOIN_PARTITION_ROWS rows each, which stay in cache while they are built
+     and can be built on separate threads. With bloom set, a Bloom filter
+     with blocks per partition rejects most keys that are not in the table
+     before their partition's slots are read. */
+  class Join_Table {
+  private:
+    struct Slot {
+      uint64_t hash;
+      uint32_t head;
+      uint32_t tail;
+    };
+    // Slots of a partition are _slots[begin] to _slots[begin + mask]
+    struct Partition {
+      size_t begin;
+      size_t mask;
+    };
+
+    const Csv& _csv;
+    const std::vector<size_t> _key_cols;
+    std::vector<Slot> _slots;
+    std::vector<Partition> _partitions;
+    std::vector<uint32_t> _next;
+    Bloom_Filter _bloom;
+    size_t _partition_mask;
+    size_t _bloom_mask;
+    size_t _max_key_col;
+
+    // Bits of the hash that select the partition, apart from those of the slot
+    static size_t partition_of(uint64_t h, size_t mask) { return (h >> 40) & mask; };
+    void insert(const Partition& partition, uint64_t h, uint32_t row);
+    // Block of the Bloom filter in partition p and the key within the block
+    size_t bloom_block(size_t p, uint64_t mixed) const { return p * (_bloom_mask + 1) + ((mixed >> 32) & _bloom_mask); };
+    static uint64_t bloom_mix(uint64_t h) {
+      h ^= h >> 33;
+      h *= 0xC4CEB9FE1A85EC53ull;
+      h ^= h >> 33;
+      return h;
+    };
+    bool row_equals(uint32_t row, const Linescan& lscan,
+		    const std::vector<size_t>& key_cols) const;
+    bool row_equals(uint32_t row, uint32_t other) const;
+
+  public:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Empty lines of csv are left out
+    Join_Table(const Csv& csv, const std::vector<size_t>& key_cols, size_t threads = 1,
+	       bool bloom = false);
+
+    /* First row of the table whose key equals the fields key_cols of lscan,
+       or NONE. key_cols has to have the same length as the table's key. */
+    uint32_t find(const Linescan& lscan, const std::vector<size_t>& key_cols) const;
+    // Next row with the same key, or NONE
+    uint32_t next(uint32_t row) const { return _next[row]; };
+
+    Join_Table(const Join_Table& o) = delete;
+    Join_Table& operator=(const Join_Table& o) = delete;
+  };
+
+  /* The fields cols of every row of a Csv, serialised once as they are
+     printed after other fields: each preceded by the delimiter. A join then
+     prints the fields of a matched row with a single copy. The payloads take
+     up to the bytes of the Csv once more. */
+  class Join_Payloads {
+  private:
+    std::vector<char> _bytes;
+    std::vector<size_t> _starts;
+    // Rows lacking one of the fields
+    std::vector<bool> _missing;
+
+  public:
+    Join_Payloads(const Csv& csv, const std::vector<size_t>& cols, char delimiter,
+		  size_t threads = 1);
+
+    // Throws for rows that lack one of the fields
+    std::string_view row(size_t idx) const {
+      if(_missing[idx]) throw std::runtime_error("Field print out of bounds");
+      return std::string_view(_bytes.data() + _starts[idx], _starts[idx+1] - _starts[idx]);
+    };
+  };
+
+  /* Reads the rows following the header of cbuf, keeping only their
+     key_columns, in that order. Empty lines are dropped. */
+  std::unique_ptr<Csv> read_keys(Input_Buffer& cbuf, char delimiter,
+				 const std::vector<std::string>& key_columns);
+
+  // Bytes, rows and fields of the rows of a join input; all SIZE_MAX if not known
+  struct Table_Size {
+    size_t bytes;
+    size_t rows;
+    size_t fields;
+  };
+
+  /* Size of the rows of the regular file of size bytes at csv_path. Its rows
+     (unless given, e.g. by an index) and fields are extrapolated from those in
+     its first JOIN_SAMPLE_SIZE bytes. Unknown for a size of SIZE_MAX. */
+  Table_Size sample_table_size(const std::string& csv_path, size_t size, char delimiter,
+			       size_t read_size, size_t rows = SIZE_MAX);
+
+  /* Bytes taken by a join table built on rows of the given size, with
+     payloads unless only the keys are kept (semi and anti joins) */
+  size_t join_memory(const Table_Size& build_size, bool payloads = true);
+
+  /* Number of partitions that keeps the build side of a join within max_memory
+     bytes (0 for no limit) */
+  size_t join_partitions(const Table_Size& build_size, size_t max_memory, bool payloads = true);
+
+  /* Splits the rows following the header of cbuf into n anonymous temporary
+     files (in $TMPDIR or /tmp) by the hash of their key columns, so that equal
+     keys of both join inputs end up in the same partition. Every file starts
+     with a copy of the header and is rewound. Empty lines are dropped; rows
+     lacking a key column go to partition 0, where the join reports them. */
+  std::vector<FILE*> partition_rows(Input_Buffer& cbuf, char delimiter,
+				    const std::vector<std::string>& key_columns,
+				    size_t n);
+
+  /* Throws unless a join of csv_1 with n_tables CSV 2 files supports
+     join_mode, sorted inputs and max_memory (0 for no limit). Several tables
+     are only hash joined in memory, as natural, left, semi or anti join. */
+  void check_join_tables(Join_Mode join_mode, size_t n_tables, bool sorted, size_t max_memory);
+
+  /* Key columns of n_tables tables, given as one list of columns separated by
+     ',' for all tables, or as one list per table separated by ':' */
+  std::vector<std::vector<std::string>> parse_key_lists(const std::string& columns,
+							size_t n_tables);
+
+  /* Joins the rows of cbuf_1 against the tables read from cbufs_2, matching
+     key_columns[i] with the i-th table, and writes them to out. All buffers
+     start at their header; the output header is only printed if
+     print_header. Several tables are joined as if one after the other: a row
+     of csv_1 is printed once for every combination of its matches, the last
+     table changing fastest, and a left join fills the columns of tables
+     without a match with empty fields. A semi join keeps the rows of csv_1
+     with a match in every table, an anti join those without a match in any.
+     With threads > 1, the tables are built in parallel, and if cbuf_1 maps
+     the file csv_path_1, its rows are probed in parallel chunks. The output
+     keeps the order of csv_1. Semi and anti joins only keep the key columns
+     of the tables. */
+  void join_buffers(Join_Mode join_mode,
+		    const std::string& csv_path_1,
+		    Input_Buffer& cbuf_1,
+		    std::vector<std::unique_ptr<Input_Buffer>> cbufs_2,
+		    char delimiter_1,
+		    char delimiter_2,
+		    const std::vector<std::vector<std::string>>& key_columns,
+		    size_t read_size,
+		    bool print_header,
+		    size_t threads,
+		    FILE* out = stdout);
+
+  /* Whether a join of csv_1 with n_tables CSV 2 files builds its table on
+     csv_1. CSV_1 and CSV_2 force a side. AUTO builds on csv_1 if its table
+     takes less memory, but only under a memory budget max_memory (0 for
+     none), where partitions may give up the order of csv_1 anyway, and only
+     if both sizes are known. Semi and anti joins only keep the keys of
+     csv_2, and several tables are probed by csv_1, so these always build on
+     csv_2; forcing CSV_1 throws for them. */
+  bool swap_join_sides(Join_Mode join_mode, Build_Side build_side, size_t n_tables,
+		       size_t max_memory, const Table_Size& size_1, const Table_Size& size_2);
+
+  /* Join of a single csv_2 with the table built from csv_1 instead, for a
+     csv_1 that is smaller. The rows of cbuf_2 are probed like those of csv_1
+     in join_buffers, and the output has the same columns and rows, but they
+     come out in the order of csv_2, followed by the rows of csv_1 without a
+     match. Throws for semi and anti joins. */
+  void join_buffers_swapped(Join_Mode join_mode,
+			    std::unique_ptr<Input_Buffer> cbuf_1,
+			    const std::string& csv_path_2,
+			    Input_Buffer& cbuf_2,
+			    char delimiter_1,
+			    char delimiter_2,
+			    const std::vector<std::string>& key_columns,
+			    size_t read_size,
+			    bool print_header,
+			    size_t threads,
+			    FILE* out = stdout);
+
+  /* Merge join of two tables that are sorted by their key columns (compared as
+     bytes, like LC_ALL=C sort). Only the rows of csv_2 that share the current
+     key are held in memory. Rows come out in key order. */
+  void merge_join_buffers(Join_Mode join_mode,
+			  Input_Buffer& cbuf_1,
+			  Input_Buffer& cbuf_2,
+			  char delimiter_1,
+			  char delimiter_2,
+			  const std::vector<std::string>& key_columns,
+			  size_t read_size,
+			  FILE* out = stdout);
+
+}
+
+#endif
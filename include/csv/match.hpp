@@ -3,17 +3,19 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include <oniguruma.h>
 
 #include <circbuf.h>
-#include <linescan.h>
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <map>
 #include <any>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <boost/regex.hpp>
@@ -23,10 +25,22 @@
 
 #include <csv/constants.hpp>
 #include <csv/error.hpp>
+#include <csv/classify.hpp>
 
 namespace csv {
 
-  class Circbuf {
+  class Input_Buffer {
+  public:
+    virtual char* head() const = 0;
+    virtual bool finished() const = 0;
+    virtual size_t read_size() const = 0;
+    virtual char* advance_head(size_t n) = 0;
+    bool at_eof() const {return head()[0] == '\0';};
+
+    virtual ~Input_Buffer(){};
+  };
+
+  class Circbuf : public Input_Buffer {
   private:
     size_t _read_size;
     size_t _buffer_size;
@@ -57,18 +71,69 @@ namespace csv {
       fclose(_fd);
     }
 
-    char* head() const {return circbuf_head(_cbuf);};
-    bool finished() const {return _cbuf->finished;};
-    size_t read_size() const {return _read_size;};
-    bool at_eof() const {return head()[0] == '\0';};
+    char* head() const override {return circbuf_head(_cbuf);};
+    bool finished() const override {return _cbuf->finished;};
+    size_t read_size() const override {return _read_size;};
 
-    char* advance_head(size_t n) {return circbuf_head_forward(_cbuf,n);};
+    char* advance_head(size_t n) override {return circbuf_head_forward(_cbuf,n);};
     
     Circbuf(const Circbuf& o) = delete; 
     Circbuf& operator=(const Circbuf& o) = delete;
     
   };
 
+  /* Maps a regular file into memory instead of copying it through a ring buffer.
+     The mapping is surrounded by the same guard areas a Circbuf provides: 
+     read_size bytes before the first byte (ending with a newline) and at least 
+     read_size zero bytes after the last one. Pages are mapped privately, so the 
+     trailing newline written by Linescan never reaches the file. 
+     A byte range of the file can be mapped on its own; bytes behind the range
+     then read as \0 as well, so scanners stop at the end of the range. */
+  class Mmap_Buffer : public Input_Buffer {
+  private:
+    const size_t _read_size;
+    char* const _map;
+    const size_t _map_size;
+    const size_t _offset;
+    char* const _begin;
+    char* const _end;
+    char* _head;
+
+  public:
+    Mmap_Buffer(char* map, size_t map_size, size_t offset,
+		char* begin, size_t size, size_t read_size) :
+      _read_size {read_size}, _map {map}, _map_size {map_size}, _offset {offset},
+      _begin {begin}, _end {begin + size}, _head {begin} {};
+
+    ~Mmap_Buffer(){
+      munmap(_map, _map_size);
+    }
+
+    static std::unique_ptr<Mmap_Buffer> create(const std::string& csv_path, size_t read_size);
+    static std::unique_ptr<Mmap_Buffer> create(const std::string& csv_path, size_t read_size,
+					       size_t offset, size_t size);
+
+    char* head() const override {return _head;};
+    bool finished() const override {return true;};
+    size_t read_size() const override {return _read_size;};
+    char* begin() const {return _begin;};
+    // Replaces the MADV_SEQUENTIAL hint, e.g. with MADV_RANDOM for lookups
+    void advise(int advice) {madvise(_map, _map_size, advice);};
+    size_t position() const {return _offset + (_head - _begin);};
+    size_t remaining() const {return _head < _end ? _end - _head : 0;};
+
+    char* advance_head(size_t n) override {
+      /* Never move further than one byte past the data. That byte is either
+	 still \0 or was turned into the final newline by Linescan, so the next
+	 one is guaranteed to be \0. */
+      _head = std::min(_head + n, _end + 1);
+      return _head;
+    };
+
+    Mmap_Buffer(const Mmap_Buffer& o) = delete; 
+    Mmap_Buffer& operator=(const Mmap_Buffer& o) = delete;
+  };
+
   class Matcher {
   public:
     virtual bool do_search(const char* begin, size_t n) = 0;
@@ -176,15 +241,16 @@ namespace csv {
   class Linescan {
   private:
     const char _delimiter;
-    const uint64_t _delimiter_mask;
     const size_t _offsets_size;
-    linescan* const _lscan;
     const char* _begin;
     std::vector<size_t> _offsets;
+    std::vector<size_t> _left_distances;
     size_t _length;
     size_t _match_field;
     size_t _n_fields;
     bool _crnl;
+
+    void scan_right(const char* buf, size_t n, const char* nl_left);
   public:
     const char* begin() const {return _begin;};
     size_t length() const {return _length;};
@@ -194,12 +260,26 @@ namespace csv {
     bool crnl() const {return _crnl;};
     std::string field_str(size_t idx) const {return std::string(this->field(idx),
 								this->field_size(idx));};
+    std::string_view field_view(size_t idx) const {return std::string_view(this->field(idx),
+									    this->field_size(idx));};
+    // All fields, e.g. the columns of a header
+    std::vector<std::string> field_strs() const;
 
     const char* field(size_t idx) const;
     size_t field_size(size_t idx) const;
     std::string str() const;
+    /* Bytes of the scanned row with its line end. In CRNL mode a last line
+       without newline has no '\r' either; its bytes are then copied into
+       scratch with "\r\n" appended, so every row ends the same way. */
+    std::string_view row(std::string& scratch) const;
 
     void do_scan(const char* buf, size_t n);
+    /* Like do_scan for a buf that is known to point to the beginning of a row
+       (i.e. buf[-1] is a newline), as when iterating rows sequentially. Only
+       scans forward. No classification is carried over from the previous
+       call: every row is classified from its first byte, since the buffer
+       behind the previous row may have been refilled in between. */
+    void do_scan_forward(const char* buf, size_t n);
     void do_scan_header(const char* buf, size_t n);
 
     void set_crnl(bool crnl) { _crnl = crnl; };
@@ -207,19 +287,14 @@ namespace csv {
 
     Linescan(char delimiter, size_t offsets_size) :
       _delimiter {delimiter},
-      _delimiter_mask {linescan_create_mask(delimiter)},
-      _offsets_size {offsets_size},
-      _lscan {linescan_create(offsets_size)}
+      _offsets_size {offsets_size}
     {
       _offsets = std::vector<size_t>();
       _offsets.reserve(_offsets_size);
+      _left_distances.reserve(_offsets_size);
       _crnl = false;
       reset();
     }
-
-    ~Linescan(){
-      linescan_free(_lscan);
-    }
     
     void reset(){
       _begin = nullptr;
@@ -234,8 +309,10 @@ namespace csv {
 
   class Buffer_Matcher {
   public:
-    virtual bool do_search(Circbuf& c,
+    virtual bool do_search(Input_Buffer& c,
 			   Linescan& result) = 0;
+    // Forget the position of the previous search before switching buffers
+    virtual void reset() = 0;
     virtual ~Buffer_Matcher(){};
   };
   
@@ -257,7 +334,8 @@ namespace csv {
       _pattern_field {pattern_field},
       _complete_match {complete_match},
       _advance_next {0} {};
-    bool do_search(Circbuf& c, Linescan& result) override;
+    bool do_search(Input_Buffer& c, Linescan& result) override;
+    void reset() override { _advance_next = 0; };
     virtual ~Multiline_BMatcher(){};
 
     Multiline_BMatcher(const Multiline_BMatcher& o) = delete; 
@@ -282,7 +360,8 @@ namespace csv {
       _pattern_field {pattern_field},
       _complete_match {complete_match},
       _advance_next {0} {};
-    bool do_search(Circbuf& c, Linescan& result) override;
+    bool do_search(Input_Buffer& c, Linescan& result) override;
+    void reset() override { _advance_next = 0; };
     bool match(const Linescan& lscan);
     virtual ~Singleline_BMatcher(){};
 
@@ -290,23 +369,60 @@ namespace csv {
     Singleline_BMatcher& operator=(const Singleline_BMatcher& o) = delete;
   };
 
-  class Csv {
+  // Fields of one row of a Csv, as spans into its arena
+  class Csv_Row {
   private:
-    std::unique_ptr<std::vector<std::string>> _columns;
-    std::unique_ptr<std::vector<std::vector<std::string>>> _fieldss;
+    const char* _begin;
+    const uint32_t* _offsets;
+    size_t _n_fields;
 
   public:
-    Csv(std::unique_ptr<std::vector<std::string>> columns,
-	std::unique_ptr<std::vector<std::vector<std::string>>> fieldss) :
-      _columns {std::move(columns)}, _fieldss {std::move(fieldss)} {};
+    Csv_Row(const char* begin, const uint32_t* offsets, size_t n_fields) :
+      _begin {begin}, _offsets {offsets}, _n_fields {n_fields} {};
 
-    static std::unique_ptr<Csv> create(std::unique_ptr<Circbuf> cbuf,
-				       char delimiter);
+    size_t size() const { return _n_fields; };
+    std::string_view operator[](size_t idx) const {
+      return std::string_view(_begin + _offsets[idx], _offsets[idx+1] - _offsets[idx] - 1);
+    };
+  };
 
-    const std::vector<std::string>& columns() const { return *_columns; };
-    const std::vector<std::vector<std::string>>& fieldss() const { return *_fieldss; };
+  /* A table held in memory. The rows are copied back to back into one arena;
+     their Linescan offsets are kept in one array, starting at
+     _offset_starts[row] for each row. */
+  class Csv {
+  private:
+    std::vector<std::string> _columns;
+    std::vector<char> _arena;
+    std::vector<size_t> _row_starts;
+    std::vector<uint32_t> _offsets;
+    std::vector<size_t> _offset_starts;
 
+  public:
+    Csv() : _offset_starts {0} {};
+    Csv(std::vector<std::string> columns) : _columns {std::move(columns)}, _offset_starts {0} {};
+
+    /* With threads > 1, a mapped file is scanned in newline-aligned
+       chunks on that many threads. */
+    static std::unique_ptr<Csv> create(std::unique_ptr<Input_Buffer> cbuf,
+				       char delimiter, size_t threads = 1);
+
+    // Copies the row last scanned by lscan
+    void append(const Linescan& lscan);
+    // Copies the given fields of the row last scanned by lscan, which must exist
+    void append(const Linescan& lscan, const std::vector<size_t>& fields);
+    // Removes all rows, but keeps the memory
+    void clear();
+
+    const std::vector<std::string>& columns() const { return _columns; };
+    size_t n_rows() const { return _row_starts.size(); };
+    Csv_Row row(size_t idx) const {
+      size_t offset_start = _offset_starts[idx];
+      return Csv_Row(_arena.data() + _row_starts[idx], _offsets.data() + offset_start,
+		     _offset_starts[idx+1] - offset_start - 1);
+    };
 
+    Csv(const Csv& o) = delete;
+    Csv& operator=(const Csv& o) = delete;
   };
   
 
@@ -0,0 +1,79 @@
+#ifndef INCLUDE_CSV_NUMBER_HPP_
+#define INCLUDE_CSV_NUMBER_HPP_
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <charconv>
+#include <string>
+#include <string_view>
+
+namespace csv {
+
+  /* Parses a whole field as a decimal number, without copying it. Empty
+     fields, trailing characters and nan are not numbers. */
+  inline bool parse_number(std::string_view s, double& r){
+    const char* begin = s.data();
+    const char* end = begin + s.size();
+    // from_chars does not accept a leading plus
+    if(begin < end && *begin == '+' && begin + 1 < end && begin[1] != '-') begin++;
+    std::from_chars_result rc = std::from_chars(begin, end, r);
+    return rc.ec == std::errc() && rc.ptr == end && !isnan(r);
+  }
+
+  // Like parse_number, for whole fields that are decimal integers
+  inline bool parse_integer(std::string_view s, int64_t& r){
+    const char* begin = s.data();
+    const char* end = begin + s.size();
+    if(begin < end && *begin == '+' && begin + 1 < end && begin[1] != '-') begin++;
+    std::from_chars_result rc = std::from_chars(begin, end, r);
+    return rc.ec == std::errc() && rc.ptr == end;
+  }
+
+  // First 8 bytes of s as an integer of the same order as the bytes
+  inline uint64_t byte_prefix(std::string_view s){
+    uint64_t r = 0;
+    memcpy(&r, s.data(), s.size() < sizeof(r) ? s.size() : sizeof(r));
+    return __builtin_bswap64(r);
+  }
+
+  // Shortest representation that reads back as x
+  inline std::string format_number(double x){
+    char buf[32];
+    std::to_chars_result rc = std::to_chars(buf, buf + sizeof(buf), x);
+    return std::string(buf, rc.ptr);
+  }
+
+  /* Adds x to the integer part sum of a sum of numbers, whose other numbers
+     add up in rest. Integers add up exactly, in any order; only those that
+     would overflow sum go to rest. */
+  inline void add_integer(int64_t& sum, double& rest, int64_t x){
+    int64_t r;
+    if(__builtin_add_overflow(sum, x, &r)) rest += x;
+    else sum = r;
+  }
+
+  // A sum of integers sum and other numbers rest, exact if rest is 0
+  inline std::string format_sum(int64_t sum, double rest){
+    return rest == 0 ? std::to_string(sum) : format_number(sum + rest);
+  }
+
+  /* x, with -0 as 0. Compared as numbers, -0 and 0 tie, so whichever comes
+     first would win as minimum or maximum; as 0 both, the result does not
+     depend on the order of rows, e.g. when partial results are merged. */
+  inline double without_negative_zero(double x){
+    return x + 0.0;
+  }
+
+  // Maps a number to an unsigned integer of the same order, above 0
+  inline uint64_t number_bits(double x){
+    x = without_negative_zero(x);
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits >> 63 ? ~bits : bits | (1ull << 63);
+  }
+
+}
+
+#endif
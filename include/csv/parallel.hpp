@@ -0,0 +1,55 @@
+#ifndef INCLUDE_CSV_PARALLEL_HPP_
+#define INCLUDE_CSV_PARALLEL_HPP_
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <csv/constants.hpp>
+#include <csv/match.hpp>
+
+namespace csv {
+
+  /* Number of chunks to split size bytes into for n_threads workers. More
+     chunks than threads keep all workers busy when chunks differ in cost. */
+  size_t chunk_count(size_t size, size_t n_threads);
+
+  /* Splits the bytes [begin, begin + size) into at most n_chunks ranges, 
+     each ending right after a newline (or at size). Returns the boundaries 
+     as offsets relative to begin, starting with 0 and ending with size. */
+  std::vector<size_t> split_lines(const char* begin, size_t size, size_t n_chunks);
+
+  /* Calls work(chunk, worker, chunk_out) for every chunk on n_threads threads.
+     Every chunk writes into its own memory stream, which is copied to out in 
+     chunk order once all previous chunks are written. At most 
+     PARALLEL_CHUNKS_PER_THREAD chunks per thread are held in memory. 
+     The first exception thrown by work is rethrown after all threads ended. */
+  void run_ordered(size_t n_chunks, size_t n_threads,
+		   const std::function<void(size_t,size_t,FILE*)>& work,
+		   FILE* out = stdout);
+
+  /* Calls work(chunk, worker) for every chunk on n_threads threads, handing out
+     chunks in order. The first exception thrown by work is rethrown after all
+     threads ended; chunks not started by then are skipped. */
+  void run_parallel(size_t n_chunks, size_t n_threads,
+		    const std::function<void(size_t,size_t)>& work);
+
+  /* Calls scan(buf, lscan, worker, out) on the rows following the header,
+     which cbuf has already moved past. If cbuf maps the regular file csv_path
+     and more than one thread is requested, the rows are split into
+     newline-aligned chunks. Every chunk gets its own buffer and Linescan and
+     is scanned by one of the workers; output is written to out in input
+     order. */
+  void scan_rows(const std::string& csv_path,
+		 Input_Buffer& cbuf,
+		 Linescan& lscan,
+		 char delimiter,
+		 size_t threads,
+		 const std::function<void(Input_Buffer&,Linescan&,size_t,FILE*)>& scan,
+		 FILE* out = stdout);
+
+}
+
+#endif
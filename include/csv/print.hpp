@@ -19,8 +19,8 @@
 namespace csv {
 
   // LCOV_EXCL_START
-  inline void print(const char* buf, size_t length) {
-    fwrite(buf, sizeof(char), length, stdout);
+  inline void print(const char* buf, size_t length, FILE* out = stdout) {
+    fwrite(buf, sizeof(char), length, out);
   }
   // LCOV_EXCL_END
   
@@ -28,12 +28,13 @@ namespace csv {
   // LCOV_EXCL_START
   inline void print_field(const char* buf,
 			  const std::vector<size_t>& offsets,
-			  size_t field_idx){
+			  size_t field_idx,
+			  FILE* out = stdout){
     size_t next_field_idx = field_idx + 1;
     assert(offsets.size() > next_field_idx);
     size_t offset = offsets[field_idx];
     size_t length = offsets[next_field_idx] - offset - 1;
-    csv::print(buf + offset, length);
+    csv::print(buf + offset, length, out);
   }
   // LCOV_EXCL_END
 
@@ -45,21 +46,60 @@ namespace csv {
     const bool _nl;
     const bool _cont;
     bool _allow_out_of_bounds;
+    FILE* _out;
     
   public:
     void print(const char* buf,
 	       const std::vector<size_t>& offsets) const;
-    void print(const std::vector<std::string>& fields) const;
+    // Fields is a vector<string> or a Csv_Row
+    template<class Fields>
+    void print(const Fields& fields) const;
     void allow_out_of_bounds(bool v) { _allow_out_of_bounds = v; };
+    void out(FILE* out) { _out = out; };
     Field_Printer(std::vector<size_t> fields,
 		  char delimiter,
 		  bool crnl,
 		  bool nl,
 		  bool cont) :
       _fields {fields}, _delimiter {delimiter}, _crnl {crnl},
-      _nl {nl}, _cont {cont}, _allow_out_of_bounds {false} {};
+      _nl {nl}, _cont {cont}, _allow_out_of_bounds {false}, _out {stdout} {};
   };
 
+  template<class Fields>
+  void Field_Printer::print(const Fields& fields) const {
+    auto print = [this, &fields](size_t field_idx)
+		 {
+		   if(field_idx < fields.size()) {
+		     const auto& field = fields[field_idx];
+		     csv::print(field.data(),field.size(),_out);
+		   } else if(_allow_out_of_bounds) {
+		     // Do nothing
+		   }
+		   else {
+		     throw std::runtime_error("Field print out of bounds");
+		   }
+		 };
+
+    if(_fields.size() > 0) {
+      if(_cont) putc(_delimiter,_out);
+      size_t fields_n = _fields.size() - 1;
+      for(size_t i=0;i<fields_n;i++){
+	size_t field_idx = _fields[i];
+	print(field_idx);
+	putc(_delimiter,_out);
+      }
+      size_t field_idx = _fields[fields_n];
+      print(field_idx);
+    }
+
+    if(_crnl){
+      putc('\r',_out);
+    }
+    if(_nl){
+      putc('\n',_out);
+    }
+  }
+
   class Linescan_Printer { // LCOV_EXCL_START
   public:
     virtual void print(const Linescan& sc_result) const = 0;
@@ -67,8 +107,12 @@ namespace csv {
   }; // LCOV_EXCL_STOP
 
   class Linescan_Line_Printer : public Linescan_Printer { // LCOV_EXCL_START
+  private:
+    FILE* const _out;
+
   public:
     void print(const Linescan& sc_result) const override;
+    Linescan_Line_Printer(FILE* out = stdout) : _out {out} {};
   }; // LCOV_EXCL_STOP
 
   class Linescan_Field_Printer : public Linescan_Printer { // LCOV_EXCL_START
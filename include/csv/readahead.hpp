@@ -0,0 +1,90 @@
+#ifndef INCLUDE_CSV_READAHEAD_HPP_
+#define INCLUDE_CSV_READAHEAD_HPP_
+
+#include <stdio.h>
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <boost/scoped_array.hpp>
+
+#include <csv/constants.hpp>
+#include <csv/match.hpp>
+
+namespace csv {
+
+  /* Input buffer that is filled by a background reader thread. The reader
+     fills a ring of blocks with read(2) while the scanning thread works on the
+     window, so the scan only waits for I/O if the reader has fallen behind.
+     Blocks are handed over through two counters (single producer, single
+     consumer); the mutex is only touched when one side has to sleep. */
+  class Readahead_Buffer : public Input_Buffer {
+  private:
+    const size_t _read_size;
+    const size_t _block_size;
+    const size_t _n_blocks;
+    const size_t _window_size;
+    boost::scoped_array<char> _blocks;
+    boost::scoped_array<size_t> _block_lengths;
+    boost::scoped_array<char> _window;
+    FILE* _fd;
+    char* _head;
+    char* _end;
+    bool _finished;
+
+    // Shared between reader and scanner
+    std::atomic<size_t> _produced;
+    std::atomic<size_t> _consumed;
+    std::atomic<bool> _eof;
+    std::atomic<bool> _stop;
+    std::atomic<int> _error;
+    std::atomic<bool> _reader_waiting;
+    std::atomic<bool> _scanner_waiting;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::thread _reader;
+
+    void read_loop();
+    bool take_block();
+    void compact();
+    void refill();
+
+    template<class Predicate>
+    void park(std::atomic<bool>& waiting, Predicate pred){
+      if(pred()) return;
+      std::unique_lock<std::mutex> lock(_mutex);
+      waiting.store(true);
+      _cv.wait(lock, pred);
+      waiting.store(false);
+    }
+
+    void unpark(const std::atomic<bool>& waiting){
+      if(!waiting.load()) return;
+      { std::lock_guard<std::mutex> lock(_mutex); }
+      _cv.notify_all();
+    }
+
+  public:
+    Readahead_Buffer(FILE* fd, size_t read_size, size_t buffer_size);
+    Readahead_Buffer(const std::string& csv_path, size_t read_size, size_t buffer_size);
+    ~Readahead_Buffer();
+
+    char* head() const override {return _head;};
+    bool finished() const override {return _finished;};
+    size_t read_size() const override {return _read_size;};
+
+    char* advance_head(size_t n) override {
+      _head += n;
+      refill();
+      return _head;
+    };
+
+    Readahead_Buffer(const Readahead_Buffer& o) = delete;
+    Readahead_Buffer& operator=(const Readahead_Buffer& o) = delete;
+  };
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef INCLUDE_CSV_SKETCH_HPP_
+#define INCLUDE_CSV_SKETCH_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <functional>
+
+#include <csv/constants.hpp>
+
+namespace csv {
+
+  // Hash of a field for the sketches, with well mixed high and low bits
+  inline uint64_t sketch_hash(std::string_view s){
+    uint64_t h = std::hash<std::string_view>{}(s);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  /* HyperLogLog estimate of the number of distinct hashes added. The top
+     bits of a hash select one of 2^bits registers, which keeps the highest
+     position of the first set bit among the remaining ones. The error is
+     about 1.04 / sqrt(2^bits). */
+  class Hyper_Log_Log {
+  private:
+    size_t _bits;
+    std::vector<uint8_t> _registers;
+
+  public:
+    Hyper_Log_Log(size_t bits = SKETCH_HLL_BITS) : _bits {bits}, _registers (1 << bits, 0) {};
+
+    void add(uint64_t h){
+      size_t idx = h >> (64 - _bits);
+      uint64_t rest = h << _bits;
+      uint8_t rank = rest == 0 ? 64 - _bits + 1 : __builtin_clzll(rest) + 1;
+      if(rank > _registers[idx]) _registers[idx] = rank;
+    };
+    // Afterwards, estimates the distinct hashes added to either sketch
+    void merge(const Hyper_Log_Log& o);
+    double estimate() const;
+  };
+
+  /* Most frequent values of a column in fixed memory. A Count-Min sketch
+     counts every value in SKETCH_CMS_DEPTH rows of counters and estimates
+     its count by the smallest of them, which may be too high but never too
+     low. The SKETCH_TOP_CANDIDATES * k values with the highest estimates so
+     far are kept as candidates, of which top lists k. The surplus lets a
+     merge of sketches of separate parts find the top values of the whole,
+     which need not be among the top k of any part. The candidates form a
+     min-heap by count, indexed by hash, so that updating one or replacing the
+     smallest takes logarithmic time. */
+  class Top_Values {
+  private:
+    struct Candidate {
+      uint64_t hash;
+      std::string value;
+      uint64_t count;
+    };
+
+    size_t _k;
+    size_t _capacity;
+    size_t _width_bits;
+    std::vector<uint64_t> _counts;
+    // Min-heap by count
+    std::vector<Candidate> _candidates;
+    // Position of every candidate in the heap, by hash
+    std::unordered_map<uint64_t,size_t> _positions;
+
+    // Multiply-shift hashing with another odd factor for every row
+    size_t counter(size_t row, uint64_t h) const {
+      static const uint64_t FACTORS[4] = {0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full,
+					  0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull};
+      return (row << _width_bits) + ((h * FACTORS[row % 4]) >> (64 - _width_bits));
+    };
+    uint64_t estimate(uint64_t h) const;
+    void offer(uint64_t h, std::string_view value, uint64_t count);
+    void swap_candidates(size_t i, size_t j);
+    void sift_up(size_t i);
+    // Restores the heap below a candidate whose count grew
+    void sift_down(size_t i);
+
+  public:
+    // width is a power of two, at least 2
+    Top_Values(size_t k = SKETCH_TOP, size_t width = SKETCH_CMS_WIDTH);
+
+    // h is the sketch_hash of value
+    void add(std::string_view value, uint64_t h);
+    // Afterwards, counts the values added to either sketch
+    void merge(const Top_Values& o);
+    // Values by descending estimated count
+    std::vector<std::pair<std::string,uint64_t>> top() const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef INCLUDE_CSV_SORT_HPP_
+#define INCLUDE_CSV_SORT_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string_view>
+#include <vector>
+
+#include <csv/match.hpp>
+
+namespace csv {
+
+  enum class Sort_Type
+    {
+     LEXICAL, NUMERIC
+    };
+
+  /* A column to sort by. Lexical keys compare as bytes. Numeric keys compare
+     as numbers; fields that are not numbers come first, in byte order. */
+  struct Sort_Key {
+    size_t col;
+    Sort_Type type;
+  };
+
+  /* Rows of a table, sorted by keys. The rows are copied back to back into
+     one arena; only the spans of their key fields are kept besides. Every key
+     field gets an 8 byte prefix that orders like the field (its first bytes,
+     or the bits of its number), so most comparisons never touch the arena.
+     Rows with equal keys keep the order in which they were appended. */
+  class Sort_Run {
+  private:
+    struct Key_Field {
+      uint64_t prefix;
+      // From the start of the row
+      uint32_t offset;
+      uint32_t size;
+    };
+    struct Entry {
+      uint64_t prefix;
+      uint32_t row;
+      // The prefix holds all of the first key field
+      bool exact;
+    };
+
+    const std::vector<Sort_Key> _keys;
+    const bool _reverse;
+    size_t _max_key_col;
+    std::vector<char> _bytes;
+    std::vector<size_t> _starts;
+    std::vector<Key_Field> _fields;
+    std::vector<Entry> _order;
+
+    std::string_view field(size_t row, size_t k) const {
+      const Key_Field& f = _fields[row * _keys.size() + k];
+      return std::string_view(_bytes.data() + _starts[row] + f.offset, f.size);
+    };
+    // Like compare, from key k on
+    int compare(size_t row, const Sort_Run& other, size_t other_row, size_t k) const;
+
+  public:
+    Sort_Run(const std::vector<Sort_Key>& keys, bool reverse = false);
+
+    /* Copies the row last scanned by lscan, which must not be empty. Throws if
+       it lacks a key field. */
+    void append(const Linescan& lscan);
+    // Computes the key prefixes and sorts the rows appended so far
+    void sort();
+    // Removes all rows, but keeps the memory
+    void clear();
+
+    size_t n_rows() const { return _starts.size() - 1; };
+    // Bytes of the rows alone
+    size_t size() const { return _bytes.size(); };
+    // Bytes held by the rows, including their keys
+    size_t memory() const {
+      return _bytes.size() + n_rows() * (sizeof(size_t) + sizeof(Entry))
+	+ _fields.size() * sizeof(Key_Field);
+    };
+    // Row at position pos of the sorted order
+    size_t sorted(size_t pos) const { return _order[pos].row; };
+    // A row including its newline
+    std::string_view line(size_t row) const {
+      return std::string_view(_bytes.data() + _starts[row], _starts[row+1] - _starts[row]);
+    };
+    /* Negative, 0 or positive as row sorts before, together with or after
+       other_row of other, a run with the same keys. */
+    int compare(size_t row, const Sort_Run& other, size_t other_row) const {
+      return compare(row, other, other_row, 0);
+    };
+    // Writes the rows in sorted order
+    void write(FILE* out) const;
+
+    Sort_Run(const Sort_Run& o) = delete;
+    Sort_Run& operator=(const Sort_Run& o) = delete;
+  };
+
+  /* Sorts the rows following the header of cbuf, which cbuf has already
+     moved past, and writes them to out. Runs of rows are sorted on threads
+     workers. With max_memory (bytes, 0 for no limit), runs that do not fit
+     are written to temporary files and merged from there, at most
+     SORT_MERGE_FANIN at a time. Empty lines are dropped; rows with equal keys
+     keep their input order. */
+  void sort_rows(Input_Buffer& cbuf, char delimiter, bool crnl,
+		 const std::vector<Sort_Key>& keys, bool reverse,
+		 size_t max_memory, size_t threads, FILE* out = stdout);
+
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef INCLUDE_CSV_SPILL_HPP_
+#define INCLUDE_CSV_SPILL_HPP_
+
+#include <stdio.h>
+
+namespace csv {
+
+  /* Creates an anonymous temporary file in $TMPDIR (or /tmp), opened for
+     writing and reading. The file is gone as soon as it is closed. */
+  FILE* create_temp_file();
+
+  // Checks that everything written to a temporary file arrived and rewinds it for reading
+  void rewind_temp_file(FILE* f);
+
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef INCLUDE_CSV_STATS_HPP_
+#define INCLUDE_CSV_STATS_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <csv/match.hpp>
+#include <csv/sketch.hpp>
+
+namespace csv {
+
+  // Type of a column: the narrowest one all of its non-empty fields fit
+  enum class Column_Type
+    {
+     EMPTY, INTEGER, NUMBER, TEXT
+    };
+
+  std::string str(Column_Type type);
+
+  /* Profile of the columns of a table, built one row at a time from the
+     fields found by Linescan. Every statistic is kept in one array with an
+     entry per column. Empty fields, and fields missing from short rows, count
+     as nulls; fields beyond the header are ignored. Profiles of separate
+     parts of a table can be merged. An approximate profile also sketches
+     the distinct values and the most frequent ones of every column, in
+     fixed memory per column. */
+  class Column_Stats {
+  private:
+    std::vector<uint64_t> _count;
+    std::vector<uint64_t> _nulls;
+    std::vector<uint64_t> _numbers;
+    std::vector<uint64_t> _integers;
+    // Sum of the integers, exact and independent of the order of rows, and of the other numbers
+    std::vector<int64_t> _integer_sum;
+    std::vector<double> _sum;
+    std::vector<double> _min;
+    std::vector<double> _max;
+    // Minimum and maximum of all non-empty fields as bytes, with their byte_prefix
+    std::vector<std::string> _text_min;
+    std::vector<std::string> _text_max;
+    std::vector<uint64_t> _text_min_prefix;
+    std::vector<uint64_t> _text_max_prefix;
+    // Only for approximate profiles
+    std::vector<Hyper_Log_Log> _distinct;
+    std::vector<Top_Values> _top;
+
+    void set_text_min(size_t col, std::string_view f, uint64_t prefix){
+      _text_min[col] = f;
+      _text_min_prefix[col] = prefix;
+    };
+    void set_text_max(size_t col, std::string_view f, uint64_t prefix){
+      _text_max[col] = f;
+      _text_max_prefix[col] = prefix;
+    };
+
+  public:
+    Column_Stats(size_t n_columns = 0, bool approx = false, size_t top = SKETCH_TOP);
+
+    // Adds the row last scanned by lscan
+    void add(const Linescan& lscan);
+    // Adds the rows of a profile of the same columns
+    void merge(const Column_Stats& o);
+
+    size_t n_columns() const { return _count.size(); };
+    // Non-empty fields of a column
+    uint64_t count(size_t col) const { return _count[col]; };
+    uint64_t nulls(size_t col) const { return _nulls[col]; };
+    Column_Type type(size_t col) const;
+    // Minimum and maximum of a column, as numbers unless its type is TEXT
+    std::string min(size_t col) const;
+    std::string max(size_t col) const;
+    // Mean of a column of numbers, or an empty string
+    std::string mean(size_t col) const;
+    bool approx() const { return !_distinct.empty(); };
+    // Estimated number of distinct non-empty fields of a column
+    std::string distinct(size_t col) const;
+    // Most frequent fields of a column with their estimated counts, as value:count;...
+    std::string top(size_t col) const;
+
+    /* Writes a table with a row per column: its name, type, count,
+       nulls, min, max and mean, and for approximate profiles distinct and top. */
+    void print(const std::vector<std::string>& columns, char delimiter,
+	       FILE* out = stdout) const;
+  };
+
+}
+
+#endif
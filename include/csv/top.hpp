@@ -0,0 +1,64 @@
+#ifndef INCLUDE_CSV_TOP_HPP_
+#define INCLUDE_CSV_TOP_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <csv/match.hpp>
+
+namespace csv {
+
+  /* The n rows with the largest numbers in column col (the smallest if
+     ascending), kept in a bounded heap while the rows stream by. The heap
+     holds the numbers as number_bits, and its root is the row that is out
+     next, so most rows are rejected after parsing a single field. Only rows
+     that enter the heap are copied, each into the buffer of its heap slot,
+     which is reused once the row is pushed out: memory stays O(n). Rows whose
+     field is not a number, or is missing, are skipped. Of rows with equal
+     numbers, those with the lower position win, so tables of separate parts
+     of an input can be merged. */
+  class Top_Rows {
+  private:
+    struct Entry {
+      uint64_t bits;
+      uint64_t position;
+      uint32_t slot;
+    };
+
+    size_t _n;
+    size_t _col;
+    bool _ascending;
+    std::vector<Entry> _heap;
+    // Rows by slot, including their newlines
+    std::vector<std::string> _rows;
+
+    // a comes before b in the output
+    bool before(const Entry& a, const Entry& b) const {
+      if(a.bits != b.bits) return _ascending ? a.bits < b.bits : a.bits > b.bits;
+      return a.position < b.position;
+    };
+    // Copies a row into the heap, unless it is full and its root comes before the row
+    void offer(uint64_t bits, uint64_t position, std::string_view line);
+
+  public:
+    Top_Rows(size_t n, size_t col, bool ascending = false);
+
+    /* Adds the row last scanned by lscan. position orders the rows of an
+       input, e.g. their byte offsets. */
+    void add(const Linescan& lscan, uint64_t position);
+    // Adds the rows of a table with the same column and order
+    void merge(const Top_Rows& o);
+
+    size_t n_rows() const { return _heap.size(); };
+    // Rows in output order, including their newlines
+    std::vector<std::string_view> rows() const;
+    void write(FILE* out = stdout) const;
+  };
+
+}
+
+#endif
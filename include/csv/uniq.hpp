@@ -0,0 +1,71 @@
+#ifndef INCLUDE_CSV_UNIQ_HPP_
+#define INCLUDE_CSV_UNIQ_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string_view>
+#include <vector>
+
+#include <csv/match.hpp>
+
+namespace csv {
+
+  /* Set of row keys, identified by the hash_key of their fields. Open
+     addressing with linear probing over the 64 bit fingerprints alone, so a
+     key takes a slot and its fingerprint, whatever its size; distinct keys
+     with the same fingerprint count as one. An exact set also copies every
+     key into an arena and compares keys as bytes. Keys are numbered in order
+     of insertion. */
+  class Key_Set {
+  private:
+    struct Slot {
+      uint64_t hash;
+      uint32_t key;
+    };
+
+    bool _exact;
+    std::vector<Slot> _slots;
+    std::vector<uint64_t> _hashes;
+    // Only for exact sets: key i is _keys[_key_starts[i]] to _keys[_key_starts[i+1]]
+    std::vector<char> _keys;
+    std::vector<size_t> _key_starts;
+
+    void grow();
+
+  public:
+    Key_Set(bool exact = false);
+
+    /* Number of the key with fingerprint h, which is inserted unless it is
+       in the set already; inserted tells which. Only exact sets read key. */
+    uint32_t insert(uint64_t h, std::string_view key, bool& inserted);
+
+    bool exact() const { return _exact; };
+    size_t size() const { return _hashes.size(); };
+    uint64_t hash(size_t i) const { return _hashes[i]; };
+    // Empty unless the set is exact
+    std::string_view key(size_t i) const {
+      if(!_exact) return std::string_view();
+      return std::string_view(_keys.data() + _key_starts[i], _key_starts[i+1] - _key_starts[i]);
+    };
+    // Bytes held by the set
+    size_t memory() const;
+    void clear();
+  };
+
+  /* Writes the first row (or with last, the last row) of every distinct key
+     in key_cols among the rows following the header of cbuf, which cbuf has
+     already moved past, to out in input order. First rows are written as
+     soon as they are read. Keys are kept in a Key_Set, exact or not. With
+     max_memory (bytes, 0 for no limit), once the keys and the last rows kept
+     outgrow it, they and all remaining rows are partitioned by key into
+     UNIQ_PARTITIONS temporary files, which are deduplicated one at a time and
+     merged back into input order. Empty lines are dropped; throws if a key
+     field is missing. */
+  void uniq_rows(Input_Buffer& cbuf, char delimiter, bool crnl,
+		 const std::vector<size_t>& key_cols, bool exact, bool last,
+		 size_t max_memory, FILE* out = stdout);
+
+}
+
+#endif
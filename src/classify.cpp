@@ -0,0 +1,212 @@
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CSV_X86
+#include <immintrin.h>
+#endif
+
+#include <csv/classify.hpp>
+
+using namespace std;
+using namespace csv;
+
+namespace {
+
+  inline void emit_forward(uint64_t mask, size_t offset, vector<size_t>& out){
+    while(mask){
+      out.push_back(offset + __builtin_ctzll(mask));
+      mask &= mask - 1;
+    }
+  }
+
+  // Bit i of mask stands for the byte end - 64 + i
+  inline void emit_backward(uint64_t mask, size_t distance, vector<size_t>& out){
+    while(mask){
+      int bit = 63 - __builtin_clzll(mask);
+      out.push_back(distance - bit);
+      mask ^= (uint64_t)1 << bit;
+    }
+  }
+
+  // Bits strictly below the lowest set bit
+  inline uint64_t below_first(uint64_t mask){ return (mask & -mask) - 1; }
+  // Bits strictly above the highest set bit
+  inline uint64_t above_last(uint64_t mask){
+    int bit = 63 - __builtin_clzll(mask);
+    return bit == 63 ? 0 : ~(((uint64_t)2 << bit) - 1);
+  }
+
+  size_t find_fields_scalar(const char* buf, size_t n, char delimiter,
+			    vector<size_t>& out, size_t offset){
+    for(size_t i=0;i<n;i++){
+      char c = buf[i];
+      if(c == NL) return i;
+      if(c == delimiter) out.push_back(offset + i);
+    }
+    return n;
+  }
+
+  size_t rfind_fields_scalar(const char* end, size_t n, char delimiter,
+			     vector<size_t>& out){
+    for(size_t d=1;d<=n;d++){
+      char c = end[-(ptrdiff_t)d];
+      if(c == NL) return d;
+      if(c == delimiter) out.push_back(d);
+    }
+    return 0;
+  }
+
+#ifdef CSV_X86
+
+  inline void classify_sse2(const char* p, char delimiter, uint64_t& m_d, uint64_t& m_nl){
+    const __m128i d = _mm_set1_epi8(delimiter);
+    const __m128i nl = _mm_set1_epi8(NL);
+    m_d = 0;
+    m_nl = 0;
+    for(int i=0;i<4;i++){
+      __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+      m_d |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, d)) << (16 * i);
+      m_nl |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) << (16 * i);
+    }
+  }
+
+  size_t find_fields_sse2(const char* buf, size_t n, char delimiter,
+			  vector<size_t>& out, size_t offset){
+    size_t i = 0;
+    for(;i+64<=n;i+=64){
+      uint64_t m_d, m_nl;
+      classify_sse2(buf + i, delimiter, m_d, m_nl);
+      if(m_nl){
+	emit_forward(m_d & below_first(m_nl), offset + i, out);
+	return i + __builtin_ctzll(m_nl);
+      }
+      emit_forward(m_d, offset + i, out);
+    }
+    return i + find_fields_scalar(buf + i, n - i, delimiter, out, offset + i);
+  }
+
+  size_t rfind_fields_sse2(const char* end, size_t n, char delimiter,
+			   vector<size_t>& out){
+    size_t d = 0;
+    for(;d+64<=n;d+=64){
+      uint64_t m_d, m_nl;
+      classify_sse2(end - d - 64, delimiter, m_d, m_nl);
+      if(m_nl){
+	emit_backward(m_d & above_last(m_nl), d + 64, out);
+	return d + 64 - (63 - __builtin_clzll(m_nl));
+      }
+      emit_backward(m_d, d + 64, out);
+    }
+    size_t tail_begin = out.size();
+    size_t r = rfind_fields_scalar(end - d, n - d, delimiter, out);
+    for(size_t i=tail_begin;i<out.size();i++) out[i] += d;
+    return r == 0 ? 0 : r + d;
+  }
+
+  __attribute__((target("avx2")))
+  inline void classify_avx2(const char* p, char delimiter, uint64_t& m_d, uint64_t& m_nl){
+    const __m256i d = _mm256_set1_epi8(delimiter);
+    const __m256i nl = _mm256_set1_epi8(NL);
+    __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    m_d = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, d))
+      | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, d)) << 32;
+    m_nl = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl))
+      | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl)) << 32;
+  }
+
+  __attribute__((target("avx2,bmi")))
+  size_t find_fields_avx2(const char* buf, size_t n, char delimiter,
+			  vector<size_t>& out, size_t offset){
+    size_t i = 0;
+    for(;i+64<=n;i+=64){
+      uint64_t m_d, m_nl;
+      classify_avx2(buf + i, delimiter, m_d, m_nl);
+      if(m_nl){
+	emit_forward(m_d & below_first(m_nl), offset + i, out);
+	return i + __builtin_ctzll(m_nl);
+      }
+      emit_forward(m_d, offset + i, out);
+    }
+    return i + find_fields_scalar(buf + i, n - i, delimiter, out, offset + i);
+  }
+
+  __attribute__((target("avx2,lzcnt")))
+  size_t rfind_fields_avx2(const char* end, size_t n, char delimiter,
+			   vector<size_t>& out){
+    size_t d = 0;
+    for(;d+64<=n;d+=64){
+      uint64_t m_d, m_nl;
+      classify_avx2(end - d - 64, delimiter, m_d, m_nl);
+      if(m_nl){
+	emit_backward(m_d & above_last(m_nl), d + 64, out);
+	return d + 64 - (63 - __builtin_clzll(m_nl));
+      }
+      emit_backward(m_d, d + 64, out);
+    }
+    size_t tail_begin = out.size();
+    size_t r = rfind_fields_scalar(end - d, n - d, delimiter, out);
+    for(size_t i=tail_begin;i<out.size();i++) out[i] += d;
+    return r == 0 ? 0 : r + d;
+  }
+
+#endif
+
+  Simd_Level detect_simd_level(){
+#ifdef CSV_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")
+       && __builtin_cpu_supports("lzcnt"))
+      return Simd_Level::AVX2;
+    if(__builtin_cpu_supports("sse2")) return Simd_Level::SSE2;
+#endif
+    return Simd_Level::SCALAR; // LCOV_EXCL_LINE
+  }
+
+}
+
+Simd_Level csv::simd_level(){
+  static const Simd_Level level = detect_simd_level();
+  return level;
+}
+
+string csv::str(Simd_Level level){
+  switch(level){
+  case Simd_Level::SCALAR: return "scalar";
+  case Simd_Level::SSE2: return "sse2";
+  case Simd_Level::AVX2: return "avx2";
+  default: throw runtime_error("Invalid SIMD level"); // LCOV_EXCL_LINE
+  }
+}
+
+size_t csv::find_fields(Simd_Level level, const char* buf, size_t n, char delimiter,
+			vector<size_t>& out, size_t offset){
+  switch(level){
+#ifdef CSV_X86
+  case Simd_Level::AVX2: return find_fields_avx2(buf, n, delimiter, out, offset);
+  case Simd_Level::SSE2: return find_fields_sse2(buf, n, delimiter, out, offset);
+#endif
+  default: return find_fields_scalar(buf, n, delimiter, out, offset);
+  }
+}
+
+size_t csv::rfind_fields(Simd_Level level, const char* end, size_t n, char delimiter,
+			 vector<size_t>& out){
+  switch(level){
+#ifdef CSV_X86
+  case Simd_Level::AVX2: return rfind_fields_avx2(end, n, delimiter, out);
+  case Simd_Level::SSE2: return rfind_fields_sse2(end, n, delimiter, out);
+#endif
+  default: return rfind_fields_scalar(end, n, delimiter, out);
+  }
+}
+
+size_t csv::find_fields(const char* buf, size_t n, char delimiter,
+			vector<size_t>& out, size_t offset){
+  return csv::find_fields(simd_level(), buf, n, delimiter, out, offset);
+}
+
+size_t csv::rfind_fields(const char* end, size_t n, char delimiter,
+			 vector<size_t>& out){
+  return csv::rfind_fields(simd_level(), end, n, delimiter, out);
+}
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include <csv/groupby.hpp>
+#include <csv/join.hpp>
+#include <csv/number.hpp>
+#include <csv/spill.hpp>
+
+using namespace std;
+using namespace csv;
+
+// Slots of an empty table; always a power of two
+static const size_t INITIAL_SLOTS = 64;
+
+string csv::str(Agg_Type type){
+  switch(type){
+  case Agg_Type::COUNT: return "count";
+  case Agg_Type::SUM: return "sum";
+  case Agg_Type::MIN: return "min";
+  case Agg_Type::MAX: return "max";
+  case Agg_Type::MEAN: return "mean";
+  }
+  throw runtime_error("Unknown aggregate"); // LCOV_EXCL_LINE
+}
+
+Agg_Type csv::agg_type(const string& name){
+  for(Agg_Type type:{Agg_Type::COUNT, Agg_Type::SUM, Agg_Type::MIN, Agg_Type::MAX, Agg_Type::MEAN})
+    if(str(type) == name) return type;
+  throw runtime_error("Unknown aggregate: " + name);
+}
+
+/* Adds n numbers, whose aggregate is x, to the aggregate value of count
+   numbers. Sums add the integers xi to integer, apart from the rest. */
+static void accumulate(Agg_Type type, uint64_t& count, double& value, int64_t& integer,
+		       uint64_t n, double x, int64_t xi){
+  if(n == 0) return;
+  if(type == Agg_Type::MIN || type == Agg_Type::MAX) x = without_negative_zero(x);
+  switch(type){
+  case Agg_Type::MIN: value = count == 0 ? x : std::min(value, x); break;
+  case Agg_Type::MAX: value = count == 0 ? x : std::max(value, x); break;
+  default:
+    value += x;
+    add_integer(integer, value, xi);
+  }
+  count += n;
+}
+
+csv::Group_Table::Group_Table(const vector<size_t>& key_cols, const vector<Aggregate>& aggs,
+			      char delimiter) :
+  _key_cols {key_cols}, _aggs {aggs}, _delimiter {delimiter},
+  _max_key_col {key_cols.empty() ? 0 : *max_element(key_cols.begin(), key_cols.end())}
+{
+  if(key_cols.empty()) throw runtime_error("No key columns");
+  clear();
+}
+
+void csv::Group_Table::clear(){
+  _slots.assign(INITIAL_SLOTS, Slot {0, 0});
+  _keys.clear();
+  _key_starts.assign(1, 0);
+  _hashes.clear();
+  _firsts.clear();
+  _rows.clear();
+  _counts.clear();
+  _values.clear();
+  _integers.clear();
+}
+
+size_t csv::Group_Table::memory() const {
+  return _slots.size() * sizeof(Slot) + _keys.size() +
+    n_groups() * (sizeof(size_t) + 3 * sizeof(uint64_t)) +
+    _counts.size() * sizeof(uint64_t) + _values.size() * sizeof(double) +
+    _integers.size() * sizeof(int64_t);
+}
+
+bool csv::Group_Table::key_equals(uint32_t group, const Linescan& lscan) const {
+  string_view k = key(group);
+  size_t pos = 0;
+  for(size_t i=0;i<_key_cols.size();i++){
+    if(i > 0){
+      if(pos >= k.size() || k[pos] != _delimiter) return false;
+      pos++;
+    }
+    string_view f = lscan.field_view(_key_cols[i]);
+    if(k.compare(pos, f.size(), f) != 0) return false;
+    pos += f.size();
+  }
+  return pos == k.size();
+}
+
+template<class Equals, class Append>
+uint32_t csv::Group_Table::find(uint64_t h, Equals equals, Append append, uint64_t first){
+  size_t mask = _slots.size() - 1;
+  for(size_t s=h & mask;;s=(s + 1) & mask){
+    Slot& slot = _slots[s];
+    if(slot.hash == h && equals(slot.group)) return slot.group;
+    if(slot.hash != 0) continue;
+
+    uint32_t g = n_groups();
+    append();
+    _key_starts.push_back(_keys.size());
+    _hashes.push_back(h);
+    _firsts.push_back(first);
+    _rows.push_back(0);
+    _counts.resize(_counts.size() + _aggs.size(), 0);
+    _values.resize(_values.size() + _aggs.size(), 0);
+    _integers.resize(_integers.size() + _aggs.size(), 0);
+    slot = Slot {h, g};
+    if(2 * n_groups() > _slots.size()) grow();
+    return g;
+  }
+}
+
+void csv::Group_Table::grow(){
+  _slots.assign(2 * _slots.size(), Slot {0, 0});
+  size_t mask = _slots.size() - 1;
+  for(uint32_t g=0;g<n_groups();g++){
+    size_t s = _hashes[g] & mask;
+    while(_slots[s].hash != 0) s = (s + 1) & mask;
+    _slots[s] = Slot {_hashes[g], g};
+  }
+}
+
+void csv::Group_Table::combine(uint32_t g, uint64_t first, uint64_t rows,
+			       const uint64_t* counts, const double* values, const int64_t* integers){
+  _firsts[g] = std::min(_firsts[g], first);
+  _rows[g] += rows;
+  size_t n_aggs = _aggs.size();
+  for(size_t a=0;a<n_aggs;a++){
+    size_t i = g * n_aggs + a;
+    accumulate(_aggs[a].type, _counts[i], _values[i], _integers[i], counts[a], values[a], integers[a]);
+  }
+}
+
+void csv::Group_Table::add(const Linescan& lscan, uint64_t position){
+  if(_max_key_col >= lscan.n_fields()) throw runtime_error("Key field missing");
+  uint64_t h = hash_key(_key_cols.size(), [&](size_t k){ return lscan.field_view(_key_cols[k]); });
+  uint32_t g = find(h,
+		    [&](uint32_t group){ return key_equals(group, lscan); },
+		    [&](){
+		      for(size_t k=0;k<_key_cols.size();k++){
+			if(k > 0) _keys.push_back(_delimiter);
+			string_view f = lscan.field_view(_key_cols[k]);
+			_keys.insert(_keys.end(), f.begin(), f.end());
+		      }
+		    },
+		    position);
+  _rows[g]++;
+
+  size_t n_aggs = _aggs.size();
+  for(size_t a=0;a<n_aggs;a++){
+    const Aggregate& agg = _aggs[a];
+    if(agg.type == Agg_Type::COUNT || agg.col >= lscan.n_fields()) continue;
+    string_view f = lscan.field_view(agg.col);
+    size_t i = g * n_aggs + a;
+    bool sum = agg.type == Agg_Type::SUM || agg.type == Agg_Type::MEAN;
+    int64_t xi;
+    double x;
+    if(sum && parse_integer(f, xi))
+      accumulate(agg.type, _counts[i], _values[i], _integers[i], 1, 0, xi);
+    else if(parse_number(f, x))
+      accumulate(agg.type, _counts[i], _values[i], _integers[i], 1, x, 0);
+  }
+}
+
+void csv::Group_Table::merge(const Group_Table& o){
+  auto same_agg = [](const Aggregate& a, const Aggregate& b){ return a.type == b.type && a.col == b.col; };
+  if(o._key_cols != _key_cols || o._aggs.size() != _aggs.size() ||
+     !equal(_aggs.begin(), _aggs.end(), o._aggs.begin(), same_agg))
+    throw runtime_error("Cannot merge groups of different keys or aggregates");
+
+  size_t n_aggs = _aggs.size();
+  for(uint32_t og=0;og<o.n_groups();og++){
+    string_view k = o.key(og);
+    uint32_t g = find(o._hashes[og],
+		      [&](uint32_t group){ return key(group) == k; },
+		      [&](){ _keys.insert(_keys.end(), k.begin(), k.end()); },
+		      o._firsts[og]);
+    combine(g, o._firsts[og], o._rows[og], &o._counts[og * n_aggs], &o._values[og * n_aggs],
+	    &o._integers[og * n_aggs]);
+  }
+}
+
+string csv::Group_Table::value(size_t group, size_t a) const {
+  size_t i = group * _aggs.size() + a;
+  switch(_aggs[a].type){
+  case Agg_Type::COUNT: return to_string(_rows[group]);
+  case Agg_Type::MEAN: return _counts[i] == 0 ? "" : format_number((_integers[i] + _values[i]) / _counts[i]);
+  case Agg_Type::SUM: return _counts[i] == 0 ? "" : format_sum(_integers[i], _values[i]);
+  default: return _counts[i] == 0 ? "" : format_number(_values[i]);
+  }
+}
+
+/* A group is written as its hash, first row, rows and key size, then the
+   key, then the counts, values and integers of its aggregates */
+void csv::Group_Table::write(const vector<FILE*>& files) const {
+  size_t n_aggs = _aggs.size();
+  for(uint32_t g=0;g<n_groups();g++){
+    // The low bits select the slot
+    FILE* f = files[(_hashes[g] >> 32) % files.size()];
+    string_view k = key(g);
+    uint64_t header[4] = {_hashes[g], _firsts[g], _rows[g], k.size()};
+    fwrite(header, sizeof(uint64_t), 4, f);
+    fwrite(k.data(), sizeof(char), k.size(), f);
+    fwrite(&_counts[g * n_aggs], sizeof(uint64_t), n_aggs, f);
+    fwrite(&_values[g * n_aggs], sizeof(double), n_aggs, f);
+    fwrite(&_integers[g * n_aggs], sizeof(int64_t), n_aggs, f);
+  }
+}
+
+void csv::Group_Table::read(FILE* f){
+  size_t n_aggs = _aggs.size();
+  string k;
+  vector<uint64_t> counts(n_aggs);
+  vector<double> values(n_aggs);
+  vector<int64_t> integers(n_aggs);
+  uint64_t header[4];
+  while(true){
+    size_t n = fread(header, sizeof(uint64_t), 4, f);
+    if(n == 0 && feof(f)) break;
+    if(n == 4) k.resize(header[3]);
+    if(n != 4 || fread(&k[0], sizeof(char), k.size(), f) != k.size() ||
+       fread(counts.data(), sizeof(uint64_t), n_aggs, f) != n_aggs ||
+       fread(values.data(), sizeof(double), n_aggs, f) != n_aggs ||
+       fread(integers.data(), sizeof(int64_t), n_aggs, f) != n_aggs)
+      throw runtime_error("Could not read temporary file"); // LCOV_EXCL_LINE
+    uint32_t g = find(header[0],
+		      [&](uint32_t group){ return key(group) == k; },
+		      [&](){ _keys.insert(_keys.end(), k.begin(), k.end()); },
+		      header[1]);
+    combine(g, header[1], header[2], counts.data(), values.data(), integers.data());
+  }
+}
+
+void csv::Group_Table::print(FILE* out) const {
+  vector<uint32_t> order(n_groups());
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return _firsts[a] < _firsts[b]; });
+  for(uint32_t g:order){
+    string_view k = key(g);
+    fwrite(k.data(), sizeof(char), k.size(), out);
+    for(size_t a=0;a<_aggs.size();a++){
+      putc(_delimiter, out);
+      fputs(value(g, a).c_str(), out);
+    }
+    putc(NL, out);
+  }
+}
+
+csv::Group_Spill::Group_Spill(size_t n_partitions) : _spilled {false} {
+  try {
+    for(size_t p=0;p<n_partitions;p++) _files.push_back(create_temp_file());
+  } catch(...) {
+    for(FILE* f:_files) fclose(f);
+    throw;
+  }
+}
+
+csv::Group_Spill::~Group_Spill(){
+  for(FILE* f:_files) fclose(f);
+}
+
+void csv::Group_Spill::spill(Group_Table& table){
+  {
+    lock_guard<mutex> lock(_mutex);
+    table.write(_files);
+    _spilled = true;
+  }
+  table.clear();
+}
+
+FILE* csv::Group_Spill::partition(size_t p){
+  rewind_temp_file(_files[p]);
+  return _files[p];
+}
@@ -1,40 +1,376 @@
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include <iostream>
 #include <fstream>
+#include <charconv>
+#include <stdexcept>
 
 #include <csv/index.hpp>
 #include <csv/st.hpp>
+#include <csv/parallel.hpp>
 
 using namespace std;
 using namespace st;
 using namespace csv;
 
-unique_ptr<Index> Index::create(const std::string& csv_path, char delimiter,
-				size_t read_size, size_t buffer_size,
-				size_t offsets_size){
-  Circbuf cbuf(csv_path, read_size, buffer_size);
+static void stat_or_throw(const string& csv_path, struct stat& st){
+  if(stat(csv_path.c_str(), &st) != 0)
+    throw runtime_error("Could not stat " + csv_path + ": " + strerror(errno));
+}
+
+static FILE* open_or_throw(const string& csv_path){
   FILE* fd = fopen(csv_path.c_str(),"r");
-  unique_ptr<Index> r = make_unique<Index>(fd, read_size);
+  if(fd == nullptr) throw runtime_error("Could not open " + csv_path + ": " + strerror(errno));
+  return fd;
+}
+
+static uint32_t delta32(uint64_t delta){
+  if(delta > UINT32_MAX) throw runtime_error("Lines are too long to be indexed"); // LCOV_EXCL_LINE
+  return delta;
+}
+
+static size_t n_anchors(size_t n_lines, size_t stride){
+  return n_lines / stride + 1;
+}
+
+static size_t index_file_size(const Index_Header& header){
+  size_t anchors = n_anchors(header.n_lines, header.stride);
+  if(header.sparse) return sizeof(Index_Header) + sizeof(uint64_t) * anchors;
+  return sizeof(Index_Header) + 2 * sizeof(uint64_t) * anchors
+    + sizeof(uint32_t) * (2 * (header.n_lines + 1) + header.n_offsets);
+}
+
+void Index::open_csv(const string& csv_path){
+  _csv_buf = Mmap_Buffer::create(csv_path, _read_size);
+  _csv_buf->advise(MADV_RANDOM);
+  _csv = _csv_buf->begin();
+}
+
+void Index::read_columns(){
+  Linescan lscan(_delimiter, _read_size);
+  lscan.do_scan_header(_csv_buf->begin(), _read_size);
+  _crnl = lscan.crnl();
+  for(size_t i=0;i<lscan.n_fields();i++)
+    _column_keys[lscan.field_str(i)] = i;
+}
+
+void Index::use_data(){
+  _anchor_offsets = _anchor_offsets_data.data();
+  _anchor_starts = _anchor_starts_data.data();
+  _line_deltas = _line_deltas_data.data();
+  _start_deltas = _start_deltas_data.data();
+  _field_offsets = _field_offsets_data.data();
+  if(_sparse){
+    _lscan = make_unique<Linescan>(_delimiter, _read_size);
+    _lscan->set_crnl(_crnl);
+  }
+}
+
+namespace {
+  /* Lines of one newline-aligned range of the CSV file. Positions are relative
+     to the start of the range, which is far below 4 GB (see chunk_count). */
+  struct Index_Chunk {
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> field_starts;
+    std::vector<uint32_t> field_offsets;
+    size_t end = 0;
+  };
+
+  void scan_chunk(const char* begin, const char* end, char delimiter, bool crnl,
+		  size_t read_size, size_t offsets_size, bool sparse, Index_Chunk& chunk){
+    Linescan lscan(delimiter, offsets_size);
+    lscan.set_crnl(crnl);
+    const char* p = begin;
+    while(p < end){
+      lscan.do_scan_forward(p, read_size);
+      chunk.starts.push_back(p - begin);
+      if(!sparse){
+	chunk.field_starts.push_back(chunk.field_offsets.size());
+	// The leading 0 of every line is implied
+	const vector<size_t>& offsets = lscan.offsets();
+	for(size_t i=1;i<offsets.size();i++)
+	  chunk.field_offsets.push_back(offsets[i]);
+      }
+      p += lscan.length();
+    }
+    chunk.end = p - begin;
+  }
+}
+
+unique_ptr<Index> Index::create(const std::string& csv_path, char delimiter,
+				size_t read_size, size_t offsets_size,
+				size_t sparse_stride,
+				size_t threads){
+  // Taken before the scan, so that a concurrent change makes the index stale
+  struct stat st;
+  stat_or_throw(csv_path, st);
+  unique_ptr<Mmap_Buffer> cbuf = Mmap_Buffer::create(csv_path, read_size);
+  unique_ptr<Index> r = make_unique<Index>(open_or_throw(csv_path), read_size);
+  r->_delimiter = delimiter;
+  r->_csv_size = st.st_size;
+  r->_csv_mtime_sec = st.st_mtim.tv_sec;
+  r->_csv_mtime_nsec = st.st_mtim.tv_nsec;
+  r->_sparse = sparse_stride > 0;
+  r->_stride = r->_sparse ? sparse_stride : INDEX_ANCHOR_STRIDE;
+
   Linescan lscan(delimiter, offsets_size);
-  lscan.do_scan_header(cbuf.head(), read_size);
-  cbuf.advance_head(lscan.length());
-  
+  lscan.do_scan_header(cbuf->head(), read_size);
+  r->_crnl = lscan.crnl();
+  cbuf->advance_head(lscan.length());
+
   for(size_t i=0;i<lscan.n_fields();i++){
     string column = string(lscan.field(i),lscan.field_size(i));
-    r->_column_keys[column] = i;    
+    r->_column_keys[column] = i;
   }
 
-  size_t len = lscan.length();
-  size_t len_sum = len;
-  r->_line_offsets.push_back(len_sum);
+  vector<uint64_t>& anchor_offsets = r->_anchor_offsets_data;
+  vector<uint64_t>& anchor_starts = r->_anchor_starts_data;
+  vector<uint32_t>& field_offsets = r->_field_offsets_data;
+  size_t stride = r->_stride;
+  bool sparse = r->_sparse;
+  size_t line = 0;
+  auto add_line_start = [&](size_t offset, size_t field_start){
+    if(line % stride == 0){
+      anchor_offsets.push_back(offset);
+      if(!sparse) anchor_starts.push_back(field_start);
+    }
+    if(sparse) return;
+    r->_line_deltas_data.push_back(delta32(offset - anchor_offsets.back()));
+    r->_start_deltas_data.push_back(delta32(field_start - anchor_starts.back()));
+  };
 
-  while(!cbuf.at_eof()){
-    lscan.do_scan(cbuf.head(), read_size);
-    r->_offsetss.push_back(lscan.offsets());
-    len = lscan.length();
-    len_sum += len;
-    r->_line_offsets.push_back(len_sum);
-    cbuf.advance_head(len);
+  /* Chunks are scanned independently (in parallel if requested) and appended
+     in file order. Only the last chunk may touch the byte behind the data. */
+  const char* head = cbuf->head();
+  size_t position = cbuf->position();
+  vector<size_t> splits = split_lines(head, cbuf->remaining(),
+				      chunk_count(cbuf->remaining(), threads));
+  size_t n_chunks = splits.size() - 1;
+  vector<Index_Chunk> chunks(n_chunks);
+  auto scan = [&](size_t c, size_t){
+    scan_chunk(head + splits[c], head + splits[c+1], delimiter, r->_crnl,
+	       read_size, offsets_size, sparse, chunks[c]);
+  };
+  auto append = [&](size_t c){
+    Index_Chunk& chunk = chunks[c];
+    size_t field_base = field_offsets.size();
+    for(size_t i=0;i<chunk.starts.size();i++){
+      add_line_start(position + splits[c] + chunk.starts[i],
+		     sparse ? 0 : field_base + chunk.field_starts[i]);
+      line++;
+    }
+    field_offsets.insert(field_offsets.end(), chunk.field_offsets.begin(), chunk.field_offsets.end());
+    // Release the partial arrays early to keep the peak memory down
+    vector<uint32_t>().swap(chunk.starts);
+    vector<uint32_t>().swap(chunk.field_starts);
+    vector<uint32_t>().swap(chunk.field_offsets);
+  };
+  if(threads <= 1){
+    for(size_t c=0;c<n_chunks;c++){
+      scan(c, 0);
+      append(c);
+    }
+  } else {
+    run_parallel(n_chunks, threads, scan);
+    for(size_t c=0;c<n_chunks;c++) append(c);
   }
+  add_line_start(position + splits[n_chunks-1] + chunks[n_chunks-1].end, field_offsets.size());
+
+  r->_n_lines = line;
+  r->_n_offsets = field_offsets.size();
+  r->use_data();
+  cbuf->advise(MADV_RANDOM);
+  r->_csv = cbuf->begin();
+  r->_csv_buf = std::move(cbuf);
   return r;
 }
 
+unique_ptr<Index> Index::load(const string& csv_path, const string& index_path,
+			      char delimiter, size_t read_size){
+  int fd = ::open(index_path.c_str(), O_RDONLY);
+  if(fd < 0) return nullptr;
+  struct stat index_st;
+  if(fstat(fd, &index_st) != 0 || (size_t)index_st.st_size < sizeof(Index_Header)) {
+    close(fd);
+    return nullptr;
+  }
+  size_t map_size = index_st.st_size;
+  void* map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED) return nullptr; // LCOV_EXCL_LINE
+
+  const Index_Header* header = (const Index_Header*)map;
+  struct stat csv_st;
+  stat_or_throw(csv_path, csv_st);
+  bool valid = memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0
+    && header->version == INDEX_VERSION
+    && header->delimiter == (uint64_t)(unsigned char)delimiter
+    && header->csv_size == (uint64_t)csv_st.st_size
+    && header->csv_mtime_sec == csv_st.st_mtim.tv_sec
+    && header->csv_mtime_nsec == csv_st.st_mtim.tv_nsec
+    && header->stride > 0 && header->sparse <= 1
+    && map_size == index_file_size(*header);
+  if(!valid){
+    munmap(map, map_size);
+    return nullptr;
+  }
+
+  unique_ptr<Index> r = make_unique<Index>(open_or_throw(csv_path), read_size);
+  r->_map = map;
+  r->_map_size = map_size;
+  r->_delimiter = delimiter;
+  r->_csv_size = header->csv_size;
+  r->_csv_mtime_sec = header->csv_mtime_sec;
+  r->_csv_mtime_nsec = header->csv_mtime_nsec;
+  r->_n_lines = header->n_lines;
+  r->_n_offsets = header->n_offsets;
+  r->_stride = header->stride;
+  r->_sparse = header->sparse;
+  r->open_csv(csv_path);
+  r->read_columns();
+  r->use_data();
+
+  size_t anchors = n_anchors(r->_n_lines, r->_stride);
+  r->_anchor_offsets = (const uint64_t*)(header + 1);
+  if(!r->_sparse){
+    r->_anchor_starts = r->_anchor_offsets + anchors;
+    r->_line_deltas = (const uint32_t*)(r->_anchor_starts + anchors);
+    r->_start_deltas = r->_line_deltas + r->_n_lines + 1;
+    r->_field_offsets = r->_start_deltas + r->_n_lines + 1;
+  }
+  return r;
+}
+
+void Index::save(const string& index_path) const {
+  Index_Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  header.version = INDEX_VERSION;
+  header.delimiter = (unsigned char)_delimiter;
+  header.csv_size = _csv_size;
+  header.csv_mtime_sec = _csv_mtime_sec;
+  header.csv_mtime_nsec = _csv_mtime_nsec;
+  header.n_lines = _n_lines;
+  header.n_offsets = _n_offsets;
+  header.stride = _stride;
+  header.sparse = _sparse;
+
+  // Written next to the target and renamed, so readers never see a partial index
+  string tmp_path = index_path + ".tmp";
+  FILE* out = fopen(tmp_path.c_str(), "w");
+  if(out == nullptr) throw runtime_error("Could not open " + tmp_path + ": " + strerror(errno));
+  size_t anchors = n_anchors(_n_lines, _stride);
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+    && fwrite(_anchor_offsets, sizeof(uint64_t), anchors, out) == anchors;
+  if(!_sparse){
+    ok = ok
+      && fwrite(_anchor_starts, sizeof(uint64_t), anchors, out) == anchors
+      && fwrite(_line_deltas, sizeof(uint32_t), _n_lines + 1, out) == _n_lines + 1
+      && fwrite(_start_deltas, sizeof(uint32_t), _n_lines + 1, out) == _n_lines + 1
+      && fwrite(_field_offsets, sizeof(uint32_t), _n_offsets, out) == _n_offsets;
+  }
+  ok = (fclose(out) == 0) && ok;
+  if(!ok || rename(tmp_path.c_str(), index_path.c_str()) != 0) { // LCOV_EXCL_START
+    int error = errno;
+    unlink(tmp_path.c_str());
+    throw runtime_error("Could not write " + index_path + ": " + strerror(error));
+  } // LCOV_EXCL_STOP
+}
+
+size_t Index::seek(size_t line_idx) const {
+  size_t anchor = line_idx / _stride;
+  if(_seek_line > line_idx || _seek_line < anchor * _stride){
+    _seek_line = anchor * _stride;
+    _seek_offset = _anchor_offsets[anchor];
+  }
+  while(_seek_line < line_idx){
+    _lscan->do_scan_forward(_csv + _seek_offset, _read_size);
+    _scanned_line = _seek_line;
+    _seek_offset += _lscan->length();
+    _seek_line++;
+  }
+  return _seek_offset;
+}
+
+const Linescan& Index::scan(size_t line_idx) const {
+  size_t offset = seek(line_idx);
+  if(_scanned_line != line_idx){
+    _lscan->do_scan_forward(_csv + offset, _read_size);
+    _scanned_line = line_idx;
+  }
+  return *_lscan;
+}
+
+vector<vector<size_t>> Index::offsetss() const {
+  vector<vector<size_t>> r;
+  r.reserve(_n_lines);
+  for(size_t i=0;i<_n_lines;i++){
+    if(_sparse) {
+      r.push_back(scan(i).offsets());
+      continue;
+    }
+    vector<size_t> offsets = {0};
+    offsets.insert(offsets.end(), _field_offsets + field_start(i), _field_offsets + field_start(i+1));
+    r.push_back(offsets);
+  }
+  return r;
+}
+
+vector<size_t> Index::line_offsets() const {
+  vector<size_t> r;
+  r.reserve(_n_lines + 1);
+  for(size_t i=0;i<=_n_lines;i++)
+    r.push_back(line_offset(i));
+  return r;
+}
+
+const char* Index::line(size_t line_idx) const {
+  if(line_idx >= _n_lines) return nullptr;
+  return _csv + line_offset(line_idx);
+}
+
+size_t Index::line_size(size_t line_idx) const {
+  if(line_idx >= _n_lines) return 0;
+  size_t begin = line_offset(line_idx);
+  // The last line may lack its newline, which the scan counts nonetheless
+  return std::min((size_t)_csv_size, line_offset(line_idx+1)) - begin;
+}
+
+const char* Index::field(size_t line_idx, size_t field_idx) const {
+  if(line_idx >= _n_lines || field_idx >= n_fields(line_idx)) return nullptr;
+  if(_sparse) return scan(line_idx).field(field_idx);
+  size_t offset = field_idx == 0 ? 0 : _field_offsets[field_start(line_idx) + field_idx - 1];
+  return _csv + line_offset(line_idx) + offset;
+}
+
+size_t Index::field_size(size_t line_idx, size_t field_idx) const {
+  if(line_idx >= _n_lines || field_idx >= n_fields(line_idx)) return 0;
+  if(_sparse) return scan(line_idx).field_size(field_idx);
+  const uint32_t* offsets = _field_offsets + field_start(line_idx) + field_idx;
+  size_t offset = field_idx == 0 ? 0 : offsets[-1];
+  return offsets[0] - offset - 1;
+}
+
+// True if all of s is a row number
+static bool parse_row(const string& s, size_t& row){
+  if(s.empty() || s[0] == '-') return false;
+  from_chars_result rc = from_chars(s.data(), s.data() + s.size(), row);
+  return rc.ec == errc() && rc.ptr == s.data() + s.size();
+}
+
+void csv::parse_row_range(const string& range, size_t& begin, size_t& end){
+  size_t sep = range.find(':');
+  string begin_s = range.substr(0, sep);
+  string end_s = sep == string::npos ? "" : range.substr(sep + 1);
+  bool ok = true;
+  begin = 0;
+  if(!begin_s.empty()) ok = parse_row(begin_s, begin);
+  if(sep == string::npos) end = begin + 1;
+  else if(end_s.empty()) end = SIZE_MAX;
+  else ok = ok && parse_row(end_s, end);
+  if(!ok || end < begin) throw runtime_error("Invalid row range: " + range);
+}
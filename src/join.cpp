@@ -0,0 +1,799 @@
+#include <string.h>
+
+#include <set>
+#include <stdexcept>
+
+#include <csv/st.hpp>
+#include <csv/join.hpp>
+#include <csv/print.hpp>
+#include <csv/parallel.hpp>
+#include <csv/spill.hpp>
+
+using namespace std;
+using namespace st;
+using namespace csv;
+
+// Separates the key columns of a table
+static const char KEY_DELIMITER = ',';
+// Separates the key columns of several tables
+static const char KEY_LIST_DELIMITER = ':';
+
+csv::Join_Table::Join_Table(const Csv& csv, const vector<size_t>& key_cols, size_t threads,
+			    bool bloom) :
+  _csv {csv}, _key_cols {key_cols},
+  _max_key_col {key_cols.empty() ? 0 : *max_element(key_cols.begin(), key_cols.end())}
+{
+  size_t n_rows = csv.n_rows();
+  if(n_rows >= NONE) throw runtime_error("Too many rows to join"); // LCOV_EXCL_LINE
+  _next.assign(n_rows, NONE);
+  size_t n_partitions = 1;
+  while(n_partitions * JOIN_PARTITION_ROWS < n_rows && n_partitions < JOIN_MAX_RADIX_PARTITIONS)
+    n_partitions *= 2;
+  _partition_mask = n_partitions - 1;
+
+  auto for_each = [threads](size_t n, const function<void(size_t,size_t)>& work){
+		    if(threads <= 1) for(size_t i=0;i<n;i++) work(i, 0);
+		    else run_parallel(n, threads, work);
+		  };
+
+  // Hash the rows in ranges and count the rows of every partition per range
+  size_t n_ranges = std::min(n_rows / JOIN_PARTITION_ROWS + 1, 
+			     std::max(threads, (size_t)1) * PARALLEL_CHUNKS_PER_THREAD);
+  vector<uint64_t> hashes(n_rows);
+  vector<vector<uint32_t>> counts(n_ranges, vector<uint32_t>(n_partitions, 0));
+  auto range_begin = [&](size_t r){ return n_rows / n_ranges * r + std::min(r, n_rows % n_ranges); };
+  for_each(n_ranges, [&](size_t r, size_t){
+		       for(size_t i=range_begin(r);i<range_begin(r+1);i++){
+			 Csv_Row row = csv.row(i);
+			 if(row.size() == 1 && row[0].empty()){
+			   hashes[i] = 0;
+			   continue;
+			 }
+			 if(_max_key_col >= row.size())
+			   throw runtime_error("Key column not found in table");
+			 hashes[i] = hash_key(key_cols.size(), [&](size_t k){ return row[key_cols[k]]; });
+			 counts[r][partition_of(hashes[i], _partition_mask)]++;
+		       }
+		     });
+
+  /* Scatter the rows by partition, keeping file order within each, and size
+     every partition's slots to at least twice its rows */
+  vector<size_t> part_starts {0};
+  size_t capacity_total = 0;
+  for(size_t p=0;p<n_partitions;p++){
+    size_t count = 0;
+    for(size_t r=0;r<n_ranges;r++){
+      size_t c = counts[r][p];
+      counts[r][p] = part_starts.back() + count;
+      count += c;
+    }
+    part_starts.push_back(part_starts.back() + count);
+    size_t capacity = 16;
+    while(capacity < 2 * count) capacity *= 2;
+    _partitions.push_back(Partition {capacity_total, capacity - 1});
+    capacity_total += capacity;
+  }
+  vector<uint32_t> order(part_starts.back());
+  for_each(n_ranges, [&](size_t r, size_t){
+		       for(size_t i=range_begin(r);i<range_begin(r+1);i++)
+			 if(hashes[i] != 0)
+			   order[counts[r][partition_of(hashes[i], _partition_mask)]++] = i;
+		     });
+  counts.clear();
+
+  // Every partition only sets bits in its own blocks of the Bloom filter
+  _bloom_mask = 0;
+  if(bloom){
+    size_t blocks = 1;
+    while(blocks * n_partitions * 256 < part_starts.back() * JOIN_BLOOM_BITS_PER_KEY) blocks *= 2;
+    _bloom = Bloom_Filter(blocks * n_partitions);
+    _bloom_mask = blocks - 1;
+  }
+
+  _slots.assign(capacity_total, Slot {0, NONE, NONE});
+  for_each(n_partitions, [&](size_t p, size_t){
+			   for(size_t j=part_starts[p];j<part_starts[p+1];j++){
+			     uint64_t h = hashes[order[j]];
+			     insert(_partitions[p], h, order[j]);
+			     if(bloom){
+			       uint64_t mixed = bloom_mix(h);
+			       _bloom.add(bloom_block(p, mixed), mixed);
+			     }
+			   }
+			 });
+}
+
+void csv::Join_Table::insert(const Partition& partition, uint64_t h, uint32_t row){
+  size_t s = h & partition.mask;
+  while(true){
+    Slot& slot = _slots[partition.begin + s];
+    if(slot.hash == 0){
+      slot = Slot {h, row, row};
+      return;
+    }
+    if(slot.hash == h && row_equals(slot.head, row)){
+      _next[slot.tail] = row;
+      slot.tail = row;
+      return;
+    }
+    s = (s + 1) & partition.mask;
+  }
+}
+
+bool csv::Join_Table::row_equals(uint32_t row, uint32_t other) const {
+  Csv_Row a = _csv.row(row);
+  Csv_Row b = _csv.row(other);
+  for(size_t col:_key_cols)
+    if(a[col] != b[col]) return false;
+  return true;
+}
+
+bool csv::Join_Table::row_equals(uint32_t row, const Linescan& lscan,
+				 const vector<size_t>& key_cols) const {
+  Csv_Row a = _csv.row(row);
+  for(size_t k=0;k<_key_cols.size();k++)
+    if(a[_key_cols[k]] != lscan.field_view(key_cols[k])) return false;
+  return true;
+}
+
+uint32_t csv::Join_Table::find(const Linescan& lscan, const vector<size_t>& key_cols) const {
+  for(size_t col:key_cols)
+    if(col >= lscan.n_fields()) // fewer fields than expected for key
+      throw runtime_error("Key field missing");
+  uint64_t h = hash_key(key_cols.size(), [&](size_t k){ return lscan.field_view(key_cols[k]); });
+  size_t p = partition_of(h, _partition_mask);
+  if(_bloom.n_blocks() > 0){
+    uint64_t mixed = bloom_mix(h);
+    if(!_bloom.contains(bloom_block(p, mixed), mixed)) return NONE;
+  }
+  const Partition& partition = _partitions[p];
+  size_t s = h & partition.mask;
+  while(true){
+    const Slot& slot = _slots[partition.begin + s];
+    if(slot.hash == 0) return NONE;
+    if(slot.hash == h && row_equals(slot.head, lscan, key_cols)) return slot.head;
+    s = (s + 1) & partition.mask;
+  }
+}
+
+csv::Join_Payloads::Join_Payloads(const Csv& csv, const vector<size_t>& cols, char delimiter,
+				  size_t threads){
+  size_t n_rows = csv.n_rows();
+  size_t max_col = cols.empty() ? 0 : *max_element(cols.begin(), cols.end());
+  _starts.assign(n_rows + 1, 0);
+  _missing.assign(n_rows, false);
+  // Sizes first, then every range of rows copies its fields in place
+  size_t n_ranges = std::max(threads, (size_t)1) * PARALLEL_CHUNKS_PER_THREAD;
+  auto range_begin = [&](size_t r){ return n_rows / n_ranges * r + std::min(r, n_rows % n_ranges); };
+  auto for_each_range = [&](const function<void(size_t,size_t)>& work){
+			  if(threads <= 1) for(size_t r=0;r<n_ranges;r++) work(r, 0);
+			  else run_parallel(n_ranges, threads, work);
+			};
+  vector<uint8_t> missing(n_rows, 0);
+  for_each_range([&](size_t r, size_t){
+		   for(size_t i=range_begin(r);i<range_begin(r+1);i++){
+		     Csv_Row row = csv.row(i);
+		     if(!cols.empty() && max_col >= row.size()){
+		       missing[i] = 1;
+		       continue;
+		     }
+		     size_t size = cols.size();
+		     for(size_t col:cols) size += row[col].size();
+		     _starts[i+1] = size;
+		   }
+		 });
+  for(size_t i=0;i<n_rows;i++){
+    _starts[i+1] += _starts[i];
+    _missing[i] = missing[i];
+  }
+  _bytes.resize(_starts[n_rows]);
+  for_each_range([&](size_t r, size_t){
+		   for(size_t i=range_begin(r);i<range_begin(r+1);i++){
+		     if(missing[i]) continue;
+		     Csv_Row row = csv.row(i);
+		     char* p = _bytes.data() + _starts[i];
+		     for(size_t col:cols){
+		       *p++ = delimiter;
+		       string_view f = row[col];
+		       memcpy(p, f.data(), f.size());
+		       p += f.size();
+		     }
+		   }
+		 });
+}
+
+// Indexes of key_columns in the header scanned by lscan
+static vector<size_t> find_key_cols(const Linescan& lscan, const vector<string>& key_columns){
+  vector<size_t> key_cols;
+  for(const string& key_column:key_columns){
+    size_t i = 0;
+    while(i < lscan.n_fields() && lscan.field_view(i) != key_column) i++;
+    if(i == lscan.n_fields()) throw runtime_error("Key column not found in table");
+    key_cols.push_back(i);
+  }
+  return key_cols;
+}
+
+unique_ptr<Csv> csv::read_keys(Input_Buffer& cbuf, char delimiter,
+			       const vector<string>& key_columns){
+  size_t read_size = cbuf.read_size();
+  Linescan lscan(delimiter, read_size);
+  lscan.do_scan_header(cbuf.head(), read_size);
+  vector<size_t> key_cols = find_key_cols(lscan, key_columns);
+  size_t max_key_col = *max_element(key_cols.begin(), key_cols.end());
+  cbuf.advance_head(lscan.length());
+
+  unique_ptr<Csv> r = make_unique<Csv>(key_columns);
+  while(!cbuf.at_eof()){
+    lscan.do_scan_forward(cbuf.head(), read_size);
+    if(lscan.length() > 1){ // Line is not empty
+      if(max_key_col >= lscan.n_fields())
+	throw runtime_error("Key column not found in table");
+      r->append(lscan, key_cols);
+    }
+    cbuf.advance_head(lscan.length());
+  }
+  return r;
+}
+
+Table_Size csv::sample_table_size(const string& csv_path, size_t size, char delimiter,
+			       size_t read_size, size_t rows){
+  if(size == SIZE_MAX) return Table_Size {SIZE_MAX, SIZE_MAX, SIZE_MAX};
+  unique_ptr<Mmap_Buffer> cbuf = Mmap_Buffer::create(csv_path, read_size, 0, JOIN_SAMPLE_SIZE);
+  Linescan lscan(delimiter, read_size);
+  lscan.do_scan_header(cbuf->head(), read_size);
+  size_t bytes = size - std::min(size, lscan.length());
+  cbuf->advance_head(lscan.length());
+
+  size_t sample_rows = 0, sample_fields = 0, sample_bytes = 0;
+  while(!cbuf->at_eof()){
+    lscan.do_scan_forward(cbuf->head(), read_size);
+    // The sample cuts off its last line, unless it holds the whole file
+    if(size > JOIN_SAMPLE_SIZE && cbuf->position() + lscan.length() > JOIN_SAMPLE_SIZE) break;
+    sample_rows++;
+    sample_fields += lscan.n_fields();
+    sample_bytes += lscan.length();
+    cbuf->advance_head(lscan.length());
+  }
+  // A single row longer than the sample
+  if(sample_rows == 0) return Table_Size {bytes, rows == SIZE_MAX ? 1 : rows, 1};
+  if(rows == SIZE_MAX)
+    rows = size <= JOIN_SAMPLE_SIZE ? sample_rows : (double)bytes / sample_bytes * sample_rows;
+  return Table_Size {bytes, rows, (size_t)((double)rows / sample_rows * sample_fields)};
+}
+
+size_t csv::join_memory(const Table_Size& build_size, bool payloads){
+  size_t r = build_size.bytes + build_size.rows * JOIN_ROW_MEMORY
+    + build_size.fields * JOIN_FIELD_MEMORY;
+  // The printed fields are at most the rows again
+  if(payloads) r += build_size.bytes + build_size.rows * JOIN_PAYLOAD_ROW_MEMORY;
+  return r;
+}
+
+size_t csv::join_partitions(const Table_Size& build_size, size_t max_memory, bool payloads){
+  if(max_memory == 0) return 1;
+  if(build_size.bytes == SIZE_MAX) return JOIN_STREAM_PARTITIONS;
+  size_t estimate = join_memory(build_size, payloads);
+  if(estimate <= max_memory) return 1;
+  // Twice the minimum, as keys are rarely spread evenly
+  return std::min(JOIN_MAX_PARTITIONS, 2 * ((estimate + max_memory - 1) / max_memory));
+}
+
+vector<FILE*> csv::partition_rows(Input_Buffer& cbuf, char delimiter,
+				  const vector<string>& key_columns, size_t n){
+  size_t read_size = cbuf.read_size();
+  Linescan lscan(delimiter, read_size);
+  lscan.do_scan_header(cbuf.head(), read_size);
+
+  vector<size_t> key_cols = find_key_cols(lscan, key_columns);
+  size_t max_key_col = *max_element(key_cols.begin(), key_cols.end());
+
+  vector<FILE*> files;
+  try {
+    for(size_t p=0;p<n;p++){
+      files.push_back(create_temp_file());
+      fwrite(lscan.begin(), sizeof(char), lscan.length(), files.back());
+    }
+    cbuf.advance_head(lscan.length());
+
+    string scratch;
+    while(!cbuf.at_eof()){
+      lscan.do_scan_forward(cbuf.head(), read_size);
+      if(lscan.length() > 1){ // Line is not empty
+	size_t p = 0;
+	if(max_key_col < lscan.n_fields()){
+	  uint64_t h = hash_key(key_cols.size(), [&](size_t k){ return lscan.field_view(key_cols[k]); });
+	  // The low bits select the slot in Join_Table
+	  p = (h >> 32) % n;
+	}
+	string_view row = lscan.row(scratch);
+	fwrite(row.data(), sizeof(char), row.size(), files[p]);
+      }
+      cbuf.advance_head(lscan.length());
+    }
+
+    for(FILE* f:files) rewind_temp_file(f);
+  } catch(...) {
+    for(FILE* f:files) fclose(f);
+    throw;
+  }
+  return files;
+}
+
+void csv::check_join_tables(Join_Mode join_mode, size_t n_tables, bool sorted, size_t max_memory){
+  if(n_tables <= 1) return;
+  if(sorted || max_memory > 0)
+    throw runtime_error("--sorted and --max-memory only support a single CSV 2");
+  if(join_mode == Join_Mode::RIGHT || join_mode == Join_Mode::FULL)
+    throw runtime_error("Right and full joins only support a single CSV 2");
+}
+
+bool csv::swap_join_sides(Join_Mode join_mode, Build_Side build_side, size_t n_tables,
+			  size_t max_memory, const Table_Size& size_1, const Table_Size& size_2){
+  bool supported = n_tables == 1 && !left_only(join_mode);
+  switch(build_side){
+  case Build_Side::CSV_1:
+    if(!supported) throw runtime_error("Semi and anti joins and several CSV 2 files build on CSV 2");
+    return true;
+  case Build_Side::CSV_2:
+    return false;
+  case Build_Side::AUTO:
+    if(!supported || max_memory == 0 || size_1.bytes == SIZE_MAX || size_2.bytes == SIZE_MAX)
+      return false;
+    return join_memory(size_1) < join_memory(size_2);
+  }
+  throw runtime_error("Unknown build side"); // LCOV_EXCL_LINE
+}
+
+vector<vector<string>> csv::parse_key_lists(const string& columns, size_t n_tables){
+  vector<vector<string>> key_columns;
+  for(const string& key_columns_s:split(columns,KEY_LIST_DELIMITER))
+    key_columns.push_back(split(key_columns_s,KEY_DELIMITER));
+  if(key_columns.size() == 1) key_columns.resize(n_tables, key_columns[0]);
+  if(key_columns.size() != n_tables)
+    throw runtime_error("Expected one list of key columns per CSV 2");
+  return key_columns;
+}
+
+static vector<size_t> key_column_idxs(const vector<string>& columns,
+				      const vector<string>& key_columns){
+  vector<size_t> key_cols;
+  for(const string& key_column:key_columns){
+    size_t key_col = find_idx(columns,key_column);
+    if(key_col == columns.size())
+      throw runtime_error("Key column not found in table");
+    key_cols.push_back(key_col);
+  }
+  return key_cols;
+}
+
+namespace {
+  // Fields of the row last scanned by a Linescan, in the shape of a Csv_Row
+  class Linescan_Row {
+  private:
+    const Linescan& _lscan;
+
+  public:
+    explicit Linescan_Row(const Linescan& lscan) : _lscan {lscan} {};
+    size_t size() const { return _lscan.n_fields(); };
+    string_view operator[](size_t idx) const { return _lscan.field_view(idx); };
+  };
+
+  /* Output of a join: all columns of csv_1, followed by the columns of each
+     csv_2 that neither csv_1 nor an earlier csv_2 has, unless left_only.
+     Rows are either scanned by a Linescan, held in a Csv (Csv_Row or
+     Linescan_Row), or serialised by Join_Payloads, so that either side of a
+     join can be the table. */
+  class Join_Printer {
+  private:
+    FILE* _out;
+    char _delimiter;
+    size_t _n_columns_1;
+    Field_Printer _printer_1;
+    vector<vector<size_t>> _specific_idxs;
+    vector<Field_Printer> _printers_2;
+    // Fields of each csv_2 for rows without a match
+    vector<string> _empty_payloads_2;
+    // Columns of csv_1 taken from the first csv_2, for its rows without a match
+    Field_Printer _printer_2_1;
+
+    static vector<size_t> common_idxs(const vector<string>& columns_1,
+				      const vector<string>& columns_2){
+      vector<size_t> r;
+      for(const string& c:columns_1)
+	r.push_back(find_idx(columns_2,c));
+      return r;
+    }
+
+    // A row with exactly the columns of csv_1 is printed as is, without its newline
+    void print_1(const Linescan& lscan_1) const {
+      if(lscan_1.n_fields() == _n_columns_1) print(lscan_1.begin(), lscan_1.offsets().back() - 1, _out);
+      else _printer_1.print(lscan_1.begin(), lscan_1.offsets());
+    }
+    void print_1(string_view payload_1) const {
+      print(payload_1.data(), payload_1.size(), _out);
+    }
+    template<class Row_1>
+    void print_1(const Row_1& row_1) const {
+      _printer_1.print(row_1);
+    }
+
+  public:
+    Join_Printer(const vector<string>& columns_1, const vector<vector<string>>& columns_2s,
+		 char delimiter, bool left_only = false, FILE* out = stdout) :
+      _out {out},
+      _delimiter {delimiter},
+      _n_columns_1 {columns_1.size()},
+      _printer_1 {numbers(0,columns_1.size()), delimiter, false, false, false},
+      _printer_2_1 {common_idxs(columns_1, columns_2s[0]), delimiter, false, false, false}
+    {
+      set<string> seen(columns_1.begin(),columns_1.end());
+      for(const vector<string>& columns_2:columns_2s){
+	vector<size_t> specific_idxs;
+	for(size_t i=0;i<columns_2.size() && !left_only;i++)
+	  if(seen.insert(columns_2[i]).second) specific_idxs.push_back(i);
+	_printers_2.emplace_back(specific_idxs, delimiter, false, false, true);
+	_printers_2.back().out(out);
+	_empty_payloads_2.emplace_back(specific_idxs.size(), delimiter);
+	_specific_idxs.push_back(std::move(specific_idxs));
+      }
+      _printer_2_1.allow_out_of_bounds(true);
+      _printer_1.out(out);
+      _printer_2_1.out(out);
+    }
+
+    // Columns printed of each csv_2, to serialise its rows with Join_Payloads
+    const vector<vector<size_t>>& specific_idxs() const { return _specific_idxs; };
+    // Serialises the printed fields of a row of the first csv_2 like Join_Payloads
+    void payload_2(const Linescan& lscan_2, string& payload) const {
+      payload.clear();
+      for(size_t idx:_specific_idxs[0]){
+	if(idx >= lscan_2.n_fields()) throw runtime_error("Field print out of bounds");
+	payload += _delimiter;
+	payload += lscan_2.field_view(idx);
+      }
+    }
+
+    template<class Row_1>
+    void print_header(const Row_1& row_1, const vector<vector<string>>& columns_2s) const {
+      print_1(row_1);
+      for(size_t i=0;i<_printers_2.size();i++)
+	_printers_2[i].print(columns_2s[i]);
+      putc(NL,_out);
+    }
+    // Row of csv_1 without a match, or any row of csv_1 if left_only
+    template<class Row_1>
+    void print_left(const Row_1& row_1) const {
+      print_1(row_1);
+      for(const string& empty:_empty_payloads_2)
+	print(empty.data(), empty.size(), _out);
+      putc(NL,_out);
+    }
+    // rows[i] is the row of payloads_2[i], or Join_Table::NONE for empty fields
+    void print_match(const Linescan& lscan_1, const vector<Join_Payloads>& payloads_2,
+		     const vector<uint32_t>& rows) const {
+      print_1(lscan_1);
+      for(size_t i=0;i<payloads_2.size();i++){
+	string_view payload = rows[i] == Join_Table::NONE ?
+	  string_view(_empty_payloads_2[i]) : payloads_2[i].row(rows[i]);
+	print(payload.data(), payload.size(), _out);
+      }
+      putc(NL,_out);
+    }
+    template<class Row_1>
+    void print_match(const Row_1& row_1, string_view payload_2) const {
+      print_1(row_1);
+      print(payload_2.data(), payload_2.size(), _out);
+      putc(NL,_out);
+    }
+    template<class Row_1, class Row_2>
+    void print_match(const Row_1& row_1, const Row_2& row_2) const {
+      print_1(row_1);
+      _printers_2[0].print(row_2);
+      putc(NL,_out);
+    }
+    // Row of the first csv_2 without a match
+    template<class Row_2>
+    void print_right(const Row_2& row_2) const {
+      _printer_2_1.print(row_2);
+      _printers_2[0].print(row_2);
+      putc(NL,_out);
+    }
+  };
+}
+
+/* Calls f on the non-empty rows of csv that are not set in any of the
+   bitvectors matched, which are either empty or have a bit per row */
+template<class F>
+static void for_each_unmatched(const Csv& csv, const vector<vector<uint64_t>>& matched, F f){
+  size_t n_words = (csv.n_rows() + 63) / 64;
+  for(size_t w=0;w<n_words;w++){
+    uint64_t word = 0;
+    for(const vector<uint64_t>& m:matched)
+      if(!m.empty()) word |= m[w];
+    size_t end = std::min(csv.n_rows(), (w + 1) * 64);
+    for(size_t idx=w*64;idx<end;idx++){
+      if(word & ((uint64_t)1 << (idx % 64))) continue;
+      Csv_Row row = csv.row(idx);
+      if(row.size() == 1 && row[0].empty()) continue;
+      f(row);
+    }
+  }
+}
+
+void csv::join_buffers(Join_Mode join_mode,
+		       const string& csv_path_1,
+		       Input_Buffer& cbuf_1,
+		       vector<unique_ptr<Input_Buffer>> cbufs_2,
+		       char delimiter_1,
+		       char delimiter_2,
+		       const vector<vector<string>>& key_columns,
+		       size_t read_size,
+		       bool print_header,
+		       size_t threads,
+		       FILE* out){
+  check_join_tables(join_mode, cbufs_2.size(), false, 0);
+  if(key_columns.size() != cbufs_2.size())
+    throw runtime_error("Expected one list of key columns per CSV 2");
+  /* Read the tables and hash their rows by key. Where rows of csv_1 without
+     a partner are dropped, a Bloom filter turns most of them away before a
+     table is probed. */
+  size_t n_tables = cbufs_2.size();
+  bool bloom = join_mode != Join_Mode::LEFT && join_mode != Join_Mode::FULL;
+  vector<unique_ptr<Csv>> csv_2s;
+  vector<unique_ptr<Join_Table>> tables_2;
+  vector<vector<string>> columns_2s;
+  for(size_t t=0;t<n_tables;t++){
+    csv_2s.push_back(left_only(join_mode) ?
+		     read_keys(*cbufs_2[t], delimiter_2, key_columns[t]) :
+		     Csv::create(std::move(cbufs_2[t]), delimiter_2, threads));
+    columns_2s.push_back(csv_2s[t]->columns());
+    tables_2.push_back(make_unique<Join_Table>(*csv_2s[t], key_column_idxs(columns_2s[t], key_columns[t]),
+					       threads, bloom));
+  }
+  cbufs_2.clear();
+
+  // Read header of csv_1
+  Linescan lscan(delimiter_1, read_size);
+  lscan.do_scan_header(cbuf_1.head(), read_size);
+  vector<string> columns_1 = lscan.field_strs();
+  vector<vector<size_t>> key_cols;
+  for(const vector<string>& table_key_columns:key_columns)
+    key_cols.push_back(key_column_idxs(columns_1,table_key_columns));
+
+  Join_Printer header_printer(columns_1, columns_2s, delimiter_1, left_only(join_mode), out);
+  if(print_header) header_printer.print_header(lscan, columns_2s);
+
+  // Advance to next line
+  cbuf_1.advance_head(lscan.length());
+
+  // The printed fields of every row of csv_2, for a single copy per match
+  vector<Join_Payloads> payloads_2;
+  if(!left_only(join_mode))
+    for(size_t t=0;t<n_tables;t++)
+      payloads_2.emplace_back(*csv_2s[t], header_printer.specific_idxs()[t], delimiter_1, threads);
+
+  // Bitvectors of the rows of csv_2 matched by each worker
+  bool track_matches = join_mode == Join_Mode::RIGHT || join_mode == Join_Mode::FULL;
+  size_t n_words = (csv_2s[0]->n_rows() + 63) / 64;
+  vector<vector<uint64_t>> matched_2(std::max(threads, (size_t)1));
+  bool keep_unmatched = join_mode == Join_Mode::LEFT || join_mode == Join_Mode::FULL;
+
+  scan_rows(csv_path_1, cbuf_1, lscan, delimiter_1, threads,
+	    [&](Input_Buffer& buf, Linescan& buf_lscan, size_t worker, FILE* chunk_out){
+	      Join_Printer printer(columns_1, columns_2s, delimiter_1, left_only(join_mode), chunk_out);
+	      vector<uint64_t>& matched = matched_2[worker];
+	      if(track_matches && matched.empty()) matched.assign(n_words, 0);
+	      // First and current match in each table
+	      vector<uint32_t> first(n_tables), rows(n_tables);
+	      // Loop through lines
+	      while(!buf.at_eof()){
+		buf_lscan.do_scan_forward(buf.head(),read_size);
+		if(buf_lscan.length() <= 1){ // Line is empty
+		  buf.advance_head(buf_lscan.length());
+		  continue;
+		}
+
+		size_t n_found = 0;
+		for(size_t t=0;t<n_tables;t++){
+		  first[t] = tables_2[t]->find(buf_lscan, key_cols[t]);
+		  if(first[t] != Join_Table::NONE) n_found++;
+		}
+		if(left_only(join_mode)){
+		  if(join_mode == Join_Mode::SEMI ? n_found == n_tables : n_found == 0)
+		    printer.print_left(buf_lscan);
+		} else if(n_found < n_tables && !keep_unmatched){ // Key not found in some csv_2
+		} else if(n_tables == 1){
+		  if(first[0] == Join_Table::NONE) printer.print_left(buf_lscan);
+		  for(uint32_t match_line = first[0];match_line != Join_Table::NONE;
+		      match_line = tables_2[0]->next(match_line)){
+		    if(track_matches) matched[match_line / 64] |= (uint64_t)1 << (match_line % 64);
+		    printer.print_match(buf_lscan, payloads_2[0].row(match_line));
+		  }
+		} else {
+		  // Every combination of matches, the last table changing fastest
+		  rows = first;
+		  size_t t = n_tables;
+		  while(t > 0){
+		    printer.print_match(buf_lscan, payloads_2, rows);
+		    for(t=n_tables;t>0;t--){
+		      uint32_t next = rows[t-1] == Join_Table::NONE ?
+			Join_Table::NONE : tables_2[t-1]->next(rows[t-1]);
+		      if(next != Join_Table::NONE){
+			rows[t-1] = next;
+			break;
+		      }
+		      rows[t-1] = first[t-1];
+		    }
+		  }
+		}
+		buf.advance_head(buf_lscan.length());
+	      }
+	    }, out);
+
+  if(track_matches){
+    Join_Printer printer(columns_1, columns_2s, delimiter_1, false, out);
+    for_each_unmatched(*csv_2s[0], matched_2, [&](const Csv_Row& row){ printer.print_right(row); });
+  }
+}
+
+void csv::join_buffers_swapped(Join_Mode join_mode,
+			       unique_ptr<Input_Buffer> cbuf_1,
+			       const string& csv_path_2,
+			       Input_Buffer& cbuf_2,
+			       char delimiter_1,
+			       char delimiter_2,
+			       const vector<string>& key_columns,
+			       size_t read_size,
+			       bool print_header,
+			       size_t threads,
+			       FILE* out){
+  // Left and right trade places
+  if(left_only(join_mode)) throw runtime_error("Semi and anti joins build their table on CSV 2");
+  bool keep_unmatched_2 = join_mode == Join_Mode::RIGHT || join_mode == Join_Mode::FULL;
+  bool track_matches = join_mode == Join_Mode::LEFT || join_mode == Join_Mode::FULL;
+
+  unique_ptr<Csv> csv_1 = Csv::create(std::move(cbuf_1), delimiter_1, threads);
+  const vector<string>& columns_1 = csv_1->columns();
+  Join_Table table_1(*csv_1, key_column_idxs(columns_1, key_columns), threads, !keep_unmatched_2);
+
+  Linescan lscan(delimiter_2, read_size);
+  lscan.do_scan_header(cbuf_2.head(), read_size);
+  vector<vector<string>> columns_2s {lscan.field_strs()};
+  vector<size_t> key_cols = key_column_idxs(columns_2s[0], key_columns);
+
+  if(print_header) Join_Printer(columns_1, columns_2s, delimiter_1, false, out).print_header(columns_1, columns_2s);
+  cbuf_2.advance_head(lscan.length());
+
+  // Rows of csv_1 with all their columns, for a single copy per match
+  Join_Payloads payloads_1(*csv_1, numbers(0,columns_1.size()), delimiter_1, threads);
+
+  size_t n_words = (csv_1->n_rows() + 63) / 64;
+  vector<vector<uint64_t>> matched_1(std::max(threads, (size_t)1));
+
+  scan_rows(csv_path_2, cbuf_2, lscan, delimiter_2, threads,
+	    [&](Input_Buffer& buf, Linescan& buf_lscan, size_t worker, FILE* chunk_out){
+	      Join_Printer printer(columns_1, columns_2s, delimiter_1, false, chunk_out);
+	      string payload_2;
+	      vector<uint64_t>& matched = matched_1[worker];
+	      if(track_matches && matched.empty()) matched.assign(n_words, 0);
+	      while(!buf.at_eof()){
+		buf_lscan.do_scan_forward(buf.head(),read_size);
+		if(buf_lscan.length() <= 1){ // Line is empty
+		  buf.advance_head(buf_lscan.length());
+		  continue;
+		}
+		uint32_t match_line = table_1.find(buf_lscan, key_cols);
+		if(match_line == Join_Table::NONE && keep_unmatched_2)
+		  printer.print_right(Linescan_Row(buf_lscan));
+		// The fields of the row are serialised once for all its matches
+		if(match_line != Join_Table::NONE) printer.payload_2(buf_lscan, payload_2);
+		for(;match_line != Join_Table::NONE;match_line = table_1.next(match_line)){
+		  if(track_matches) matched[match_line / 64] |= (uint64_t)1 << (match_line % 64);
+		  printer.print_match(payloads_1.row(match_line).substr(1), string_view(payload_2));
+		}
+		buf.advance_head(buf_lscan.length());
+	      }
+	    }, out);
+
+  if(track_matches){
+    Join_Printer printer(columns_1, columns_2s, delimiter_1, false, out);
+    for_each_unmatched(*csv_1, matched_1, [&](const Csv_Row& row){ printer.print_left(row); });
+  }
+}
+
+// Compares the key fields of lscan with key, field by field as bytes
+static int compare_key(const Linescan& lscan, const vector<size_t>& key_cols,
+		       const vector<string>& key){
+  for(size_t k=0;k<key_cols.size();k++){
+    if(key_cols[k] >= lscan.n_fields()) // fewer fields than expected for key
+      throw runtime_error("Key field missing");
+    int c = lscan.field_view(key_cols[k]).compare(key[k]);
+    if(c != 0) return c;
+  }
+  return 0;
+}
+
+/* Scans the next non-empty row of cbuf without moving past it.
+   Returns false at the end of the input. */
+static bool peek_row(Input_Buffer& cbuf, Linescan& lscan){
+  size_t read_size = cbuf.read_size();
+  while(!cbuf.at_eof()){
+    lscan.do_scan_forward(cbuf.head(), read_size);
+    if(lscan.length() > 1) return true;
+    cbuf.advance_head(lscan.length());
+  }
+  return false;
+}
+
+void csv::merge_join_buffers(Join_Mode join_mode,
+			     Input_Buffer& cbuf_1,
+			     Input_Buffer& cbuf_2,
+			     char delimiter_1,
+			     char delimiter_2,
+			     const vector<string>& key_columns,
+			     size_t read_size,
+			     FILE* out){
+  Linescan lscan_2(delimiter_2, read_size);
+  lscan_2.do_scan_header(cbuf_2.head(), read_size);
+  vector<string> columns_2 = lscan_2.field_strs();
+  vector<size_t> key_cols_2 = key_column_idxs(columns_2, key_columns);
+  cbuf_2.advance_head(lscan_2.length());
+
+  Linescan lscan_1(delimiter_1, read_size);
+  lscan_1.do_scan_header(cbuf_1.head(), read_size);
+  vector<string> columns_1 = lscan_1.field_strs();
+  vector<size_t> key_cols_1 = key_column_idxs(columns_1, key_columns);
+
+  Join_Printer printer(columns_1, {columns_2}, delimiter_1, left_only(join_mode), out);
+  printer.print_header(lscan_1, {columns_2});
+  cbuf_1.advance_head(lscan_1.length());
+
+  auto check_order = [](const Linescan& lscan, const vector<size_t>& key_cols,
+			vector<string>& prev_key, const string& name){
+		       if(!prev_key.empty() && compare_key(lscan, key_cols, prev_key) < 0)
+			 throw runtime_error(name + " is not sorted by the key columns");
+		       prev_key.resize(key_cols.size());
+		       for(size_t k=0;k<key_cols.size();k++)
+			 prev_key[k].assign(lscan.field_view(key_cols[k]));
+		     };
+
+  // Rows of csv_2 with the key group_key; semi and anti joins only need one
+  Csv group(columns_2);
+  vector<string> group_key;
+  bool group_matched = false;
+  auto next_group = [&](){
+		      if(!group_matched && (join_mode == Join_Mode::RIGHT || join_mode == Join_Mode::FULL))
+			for(size_t i=0;i<group.n_rows();i++)
+			  printer.print_right(group.row(i));
+		      group.clear();
+		      group_matched = false;
+		      if(!peek_row(cbuf_2, lscan_2)) return;
+		      check_order(lscan_2, key_cols_2, group_key, "CSV 2");
+		      do {
+			if(!left_only(join_mode) || group.n_rows() == 0) group.append(lscan_2);
+			cbuf_2.advance_head(lscan_2.length());
+		      } while(peek_row(cbuf_2, lscan_2) && compare_key(lscan_2, key_cols_2, group_key) == 0);
+		    };
+
+  vector<string> key_1;
+  next_group();
+  while(peek_row(cbuf_1, lscan_1)){
+    check_order(lscan_1, key_cols_1, key_1, "CSV 1");
+    while(group.n_rows() > 0 && compare_key(lscan_1, key_cols_1, group_key) > 0)
+      next_group();
+    bool match = group.n_rows() > 0 && compare_key(lscan_1, key_cols_1, group_key) == 0;
+    if(left_only(join_mode)){
+      if(match == (join_mode == Join_Mode::SEMI)) printer.print_left(lscan_1);
+    } else if(match){
+      for(size_t i=0;i<group.n_rows();i++)
+	printer.print_match(lscan_1, group.row(i));
+      group_matched = true;
+    } else if(join_mode == Join_Mode::LEFT || join_mode == Join_Mode::FULL){
+      printer.print_left(lscan_1);
+    }
+    cbuf_1.advance_head(lscan_1.length());
+  }
+  while(group.n_rows() > 0)
+    next_group();
+}
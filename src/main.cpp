@@ -1,5 +1,6 @@
 
 #include <poll.h>
+#include <sys/stat.h>
 
 #include <boost/regex.hpp>
 #include <boost/format.hpp>
@@ -10,13 +11,23 @@
 #include <csv/error.hpp>
 #include <csv/match.hpp>
 #include <csv/print.hpp>
+#include <csv/readahead.hpp>
+#include <csv/parallel.hpp>
+#include <csv/index.hpp>
+#include <csv/join.hpp>
+#include <csv/sort.hpp>
+#include <csv/stats.hpp>
+#include <csv/groupby.hpp>
+#include <csv/top.hpp>
+#include <csv/uniq.hpp>
 
 using namespace std;
 using namespace st;
 using namespace csv;
 
 static const char ARG_DELIMITER = ',';
-static const string KEY_DELIMITER = ",";
+// Separates an aggregate from its column
+static const char AGG_DELIMITER = ':';
 
 enum class Matcher_Type
   {
@@ -28,28 +39,37 @@ enum class Buffer_Matcher_Type
    LINE, MULTILINE
   };
 
-enum class Join_Mode
-  {
-   NATURAL, LEFT, RIGHT, FULL
-  };
-
 static const map<string,Join_Mode> JOIN_MODES =
   {
    {"natural",Join_Mode::NATURAL},
    {"left",Join_Mode::LEFT},
    {"right",Join_Mode::RIGHT},
-   {"full",Join_Mode::FULL}
+   {"full",Join_Mode::FULL},
+   {"semi",Join_Mode::SEMI},
+   {"anti",Join_Mode::ANTI}
+  };
+
+static const map<string,Build_Side> BUILD_SIDES =
+  {
+   {"auto",Build_Side::AUTO},
+   {"1",Build_Side::CSV_1},
+   {"2",Build_Side::CSV_2}
   };
-					       
 
-unique_ptr<Circbuf> create_circbuf(string csv_path, size_t read_size, size_t buffer_size){
-  if(!csv_path.empty())
-    return make_unique<Circbuf>(csv_path,read_size,buffer_size);
+unique_ptr<Input_Buffer> create_buffer(string csv_path, size_t read_size, size_t buffer_size,
+				       bool readahead){
+  if(!csv_path.empty()){
+    // Regular files are mapped directly, everything else (pipes, devices) is read ahead
+    struct stat st;
+    if(!readahead && stat(csv_path.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+      return Mmap_Buffer::create(csv_path, read_size);
+    return make_unique<Readahead_Buffer>(csv_path,read_size,buffer_size);
+  }
   
   struct pollfd pfd = { fileno(stdin), POLLIN };
   int rc = poll(&pfd,1,POLL_TIMEOUT);
   if(rc > 0 && pfd.revents & POLLIN)
-    return make_unique<Circbuf>(stdin, read_size, buffer_size);
+    return make_unique<Readahead_Buffer>(stdin, read_size, buffer_size);
   else
     throw runtime_error("Could not read data from file or STDIN");
 }
@@ -129,10 +149,11 @@ size_t column_index(const Linescan& sc_result, string column){
 }
 
 unique_ptr<Linescan_Printer> create_printer(const Linescan& sc_result, char delimiter,
-					     const vector<string>& out_columns){
+					     const vector<string>& out_columns,
+					     FILE* out = stdout){
   unique_ptr<Linescan_Printer> r(nullptr);
   if(out_columns.empty()) {
-    r = make_unique<Linescan_Line_Printer>();
+    r = make_unique<Linescan_Line_Printer>(out);
     return r;
   }
   vector<size_t> idxs;
@@ -140,14 +161,49 @@ unique_ptr<Linescan_Printer> create_printer(const Linescan& sc_result, char deli
     size_t idx = column_index(sc_result,column);
     idxs.push_back(idx);
   }
-  r = make_unique<Linescan_Field_Printer>(make_unique<Field_Printer>(idxs,
-								     delimiter,
-								     sc_result.crnl(),
-								     true,
-								     false));
+  auto field_printer = make_unique<Field_Printer>(idxs,
+						  delimiter,
+						  sc_result.crnl(),
+						  true,
+						  false);
+  field_printer->out(out);
+  r = make_unique<Linescan_Field_Printer>(move(field_printer));
   return r;
 }
 
+void select_rows(Input_Buffer& cbuf,
+		 Linescan& lscan,
+		 Buffer_Matcher& lead_bmatcher,
+		 const vector<unique_ptr<Singleline_BMatcher>>& shadow_bmatchers,
+		 const Linescan_Printer& printer){
+  lead_bmatcher.reset();
+  while(!cbuf.at_eof()){
+  outer:
+    bool match = lead_bmatcher.do_search(cbuf, lscan);
+    if(!match) continue;
+    for(size_t i=0;i<shadow_bmatchers.size();i++){
+      match = shadow_bmatchers[i]->match(lscan);
+      if(!match) goto outer;
+    }
+    printer.print(lscan);
+  }
+}
+
+void cut_rows(Input_Buffer& cbuf,
+	      Linescan& lscan,
+	      char delimiter,
+	      const Linescan_Printer& printer){
+  size_t read_size = cbuf.read_size();
+  while(!cbuf.at_eof()){
+    char* head = cbuf.head();
+    char* del = simple_scan_right(head,read_size,delimiter);
+    if(del==nullptr && head[0] != NL) throw runtime_error("Could not find delimiter in line");
+    lscan.do_scan_forward(head,read_size);
+    printer.print(lscan);
+    cbuf.advance_head(lscan.length());
+  }
+}
+
 void run_select(const string& csv_path,
 		const vector<string>& columns,
 		const vector<string>& regexs,
@@ -157,7 +213,9 @@ void run_select(const string& csv_path,
 		const vector<string>& out_columns,
 		int lead_regex_idx,
 		size_t read_size,
-		size_t buffer_size){
+		size_t buffer_size,
+		bool readahead,
+		size_t threads){
   vector<string> patterns;
   Matcher_Type matcher_type;
   Matcher_Type shadow_matcher_type;
@@ -192,7 +250,7 @@ void run_select(const string& csv_path,
   }
 
   // Prepare buffers
-  unique_ptr<Circbuf> cbuf = create_circbuf(csv_path, read_size, buffer_size);
+  unique_ptr<Input_Buffer> cbuf = create_buffer(csv_path, read_size, buffer_size, readahead);
   Linescan lscan(delimiter, read_size);
 
   // Scan and print header
@@ -212,32 +270,32 @@ void run_select(const string& csv_path,
   patterns.erase(patterns.begin() + lead_regex_idx);
   cols.erase(cols.begin() + lead_regex_idx);
   
-  unique_ptr<Buffer_Matcher> lead_bmatcher = create_buffer_matcher(bmatcher_type,
-								   matcher_type,
-								   lead_regex,
-								   delimiter,
-								   lead_col, complete_match);
-  
-  vector<unique_ptr<Singleline_BMatcher>> shadow_bmatchers = create_shadow_buffer_matchers(
-								 shadow_matcher_type,
-								 patterns,
-								 cols,
-								 delimiter,
-								 complete_match);
+  // Every worker gets its own set of matchers
+  size_t n_workers = std::max(threads, (size_t)1);
+  vector<unique_ptr<Buffer_Matcher>> lead_bmatchers;
+  vector<vector<unique_ptr<Singleline_BMatcher>>> shadow_bmatcherss;
+  for(size_t i=0;i<n_workers;i++){
+    lead_bmatchers.push_back(create_buffer_matcher(bmatcher_type,
+						   matcher_type,
+						   lead_regex,
+						   delimiter,
+						   lead_col, complete_match));
+    shadow_bmatcherss.push_back(create_shadow_buffer_matchers(shadow_matcher_type,
+							      patterns,
+							      cols,
+							      delimiter,
+							      complete_match));
+  }
   // Move past header
   cbuf->advance_head(lscan.length());
 
   // Match loop
-  while(!cbuf->at_eof()){
-  outer:
-    bool match = lead_bmatcher->do_search(*cbuf, lscan);
-    if(!match) continue;
-    for(size_t i=0;i<shadow_bmatchers.size();i++){
-      match = shadow_bmatchers[i]->match(lscan);
-      if(!match) goto outer;
-    }
-    printer->print(lscan);
-  }
+  scan_rows(csv_path, *cbuf, lscan, delimiter, threads,
+	    [&](Input_Buffer& buf, Linescan& buf_lscan, size_t worker, FILE* out){
+	      select_rows(buf, buf_lscan, *lead_bmatchers[worker],
+			  shadow_bmatcherss[worker],
+			  *create_printer(lscan, delimiter, out_columns, out));
+	    });
 
   return;
 }
@@ -246,8 +304,10 @@ void run_cut(const string& csv_path,
 	     char delimiter,
 	     const vector<string>& out_columns,
 	     size_t read_size,
-	     size_t buffer_size){
-  unique_ptr<Circbuf> cbuf = create_circbuf(csv_path, read_size, buffer_size);
+	     size_t buffer_size,
+	     bool readahead,
+	     size_t threads){
+  unique_ptr<Input_Buffer> cbuf = create_buffer(csv_path, read_size, buffer_size, readahead);
   Linescan lscan(delimiter, read_size);
 
   lscan.do_scan_header(cbuf->head(), cbuf->read_size());
@@ -256,182 +316,374 @@ void run_cut(const string& csv_path,
   printer->print(lscan);
 
   cbuf->advance_head(lscan.length());
-  while(!cbuf->at_eof()){
-    char* head = cbuf->head();
-    char* del = simple_scan_right(head,read_size,delimiter);
-    if(del==nullptr) throw runtime_error("Could not find delimiter in line");
-    lscan.do_scan(head,read_size);
-    printer->print(lscan);
-    cbuf->advance_head(lscan.length());
-  }
+  scan_rows(csv_path, *cbuf, lscan, delimiter, threads,
+	    [&](Input_Buffer& buf, Linescan& buf_lscan, size_t, FILE* out){
+	      cut_rows(buf, buf_lscan, delimiter,
+		       *create_printer(lscan, delimiter, out_columns, out));
+	    });
   return;
 }
 
-string multi_key(const vector<string>& fields,
-		 const vector<size_t>& idxs){
-  string r;
-  for(size_t i:idxs) {
-    if(i >= fields.size())
-      throw runtime_error("Key column not found in table");
-    r.append(fields[i]);
-    r.append(KEY_DELIMITER);
-  }
-  return r;
+// Size of the regular file at csv_path, or SIZE_MAX for STDIN and other files
+size_t regular_file_size(const string& csv_path){
+  struct stat st;
+  return !csv_path.empty() && stat(csv_path.c_str(), &st) == 0
+    && S_ISREG(st.st_mode) ? st.st_size : SIZE_MAX;
 }
 
-string multi_key(const csv::Linescan& lscan,
-		 const vector<size_t>& idxs){
-  string key;
-  for(size_t i:idxs){
-    if(i >= lscan.n_fields()) { // fewer fields than expected for key
-      throw runtime_error("Key field missing");
+// Rows of csv_path according to its index, or SIZE_MAX without an up to date index
+size_t indexed_rows(const string& csv_path, char delimiter, size_t read_size){
+  if(regular_file_size(csv_path) == SIZE_MAX) return SIZE_MAX;
+  unique_ptr<Index> idx = Index::load(csv_path, Index::sidecar_path(csv_path), delimiter, read_size);
+  return idx ? idx->n_lines() : SIZE_MAX;
+}
+
+void run_join(Join_Mode join_mode,
+	      const string& csv_path_1,
+	      const vector<string>& csv_paths_2,
+	      char delimiter_1,
+	      char delimiter_2,
+	      const vector<vector<string>>& key_columns,
+	      size_t read_size,
+	      size_t buffer_size,
+	      bool readahead,
+	      size_t max_memory,
+	      bool sorted,
+	      Build_Side build_side,
+	      size_t threads){
+  check_join_tables(join_mode, csv_paths_2.size(), sorted, max_memory);
+  vector<unique_ptr<Input_Buffer>> cbufs_2;
+  for(const string& csv_path_2:csv_paths_2)
+    cbufs_2.push_back(create_buffer(csv_path_2, read_size, buffer_size, readahead));
+  if(sorted){
+    unique_ptr<Input_Buffer> cbuf_1 = create_buffer(csv_path_1, read_size, buffer_size, readahead);
+    merge_join_buffers(join_mode, *cbuf_1, *cbufs_2[0], delimiter_1, delimiter_2,
+		       key_columns[0], read_size);
+    return;
+  }
+  const string& csv_path_2 = csv_paths_2[0];
+  /* Under a memory budget, the sizes of the tables on either file decide
+     the partitions and the side to build on. Up to date indexes tell the
+     row counts. */
+  Table_Size unknown {SIZE_MAX, SIZE_MAX, SIZE_MAX};
+  Table_Size size_1 = unknown, size_2 = unknown;
+  if(csv_paths_2.size() == 1 && max_memory > 0){
+    size_1 = sample_table_size(csv_path_1, regular_file_size(csv_path_1), delimiter_1, read_size,
+			       indexed_rows(csv_path_1, delimiter_1, read_size));
+    size_2 = sample_table_size(csv_path_2, regular_file_size(csv_path_2), delimiter_2, read_size,
+			       indexed_rows(csv_path_2, delimiter_2, read_size));
+  }
+  bool swap = swap_join_sides(join_mode, build_side, csv_paths_2.size(), max_memory, size_1, size_2);
+  size_t partitions = csv_paths_2.size() > 1 ? 1 :
+    join_partitions(swap ? size_1 : size_2, max_memory, !left_only(join_mode));
+  unique_ptr<Input_Buffer> cbuf_1 = create_buffer(csv_path_1, read_size, buffer_size, readahead);
+
+  if(partitions <= 1){
+    if(swap)
+      join_buffers_swapped(join_mode, std::move(cbuf_1), csv_path_2, *cbufs_2[0], delimiter_1, delimiter_2,
+			   key_columns[0], read_size, true, threads);
+    else
+      join_buffers(join_mode, csv_path_1, *cbuf_1, std::move(cbufs_2), delimiter_1, delimiter_2,
+		   key_columns, read_size, true, threads);
+    return;
+  }
+
+  /* Grace hash join: equal keys of both tables land in the same partition,
+     so the partitions can be joined one after the other. Rows come out
+     grouped by partition instead of in input order. */
+  vector<FILE*> partitions_2 = partition_rows(*cbufs_2[0], delimiter_2, key_columns[0], partitions);
+  cbufs_2.clear();
+  vector<FILE*> partitions_1;
+  try {
+    partitions_1 = partition_rows(*cbuf_1, delimiter_1, key_columns[0], partitions);
+  } catch(...) {
+    for(FILE* f:partitions_2) fclose(f);
+    throw;
+  }
+  cbuf_1.reset();
+
+  try {
+    for(size_t p=0;p<partitions;p++){
+      // The buffers take over the files
+      unique_ptr<Input_Buffer> part_1 = make_unique<Readahead_Buffer>(partitions_1[p], read_size, buffer_size);
+      partitions_1[p] = nullptr;
+      unique_ptr<Input_Buffer> part_2 = make_unique<Readahead_Buffer>(partitions_2[p], read_size, buffer_size);
+      partitions_2[p] = nullptr;
+      if(swap){
+	join_buffers_swapped(join_mode, std::move(part_1), "", *part_2, delimiter_1, delimiter_2,
+			     key_columns[0], read_size, p == 0, threads);
+      } else {
+	vector<unique_ptr<Input_Buffer>> parts_2;
+	parts_2.push_back(std::move(part_2));
+	join_buffers(join_mode, "", *part_1, std::move(parts_2), delimiter_1, delimiter_2,
+		     key_columns, read_size, p == 0, threads);
+      }
     }
-    key.append(lscan.field_str(i));
-    key.append(KEY_DELIMITER);
+  } catch(...) {
+    // Partitions not yet taken over by a buffer
+    for(FILE* f:partitions_1) if(f) fclose(f);
+    for(FILE* f:partitions_2) if(f) fclose(f);
+    throw;
   }
-  return key;
 }
 
-vector<size_t> key_column_idxs(const vector<string>& columns,
-			       const vector<string>& key_columns){
-  vector<size_t> key_cols;
-  for(const string& key_column:key_columns){
-    size_t key_col = find_idx(columns,key_column);
-    if(key_col == columns.size())
-      throw runtime_error("Key column not found in table");
-    key_cols.push_back(key_col);
-  }
-  return key_cols;
+void run_index(const string& csv_path,
+	       char delimiter,
+	       size_t read_size,
+	       size_t sparse_stride,
+	       size_t threads){
+  unique_ptr<Index> idx = Index::create(csv_path, delimiter, read_size, read_size,
+					sparse_stride, threads);
+  idx->save(Index::sidecar_path(csv_path));
 }
 
-unordered_map<string,size_t> keyed_fields(const Csv& csv,
-					  const vector<string>& key_columns){
-  unordered_map<string,size_t> r;
-  vector<string> columns = csv.columns();
-  vector<size_t> key_cols = key_column_idxs(columns, key_columns);
-  vector<vector<string>> fieldss = csv.fieldss();
-  for(size_t i=0;i<fieldss.size();i++){
-    const vector<string>& fields = fieldss[i];
-    if(fields.size() == 1 && fields[0] == "") continue;
-    string key = multi_key(fields, key_cols);
-    r[key] = i;
+void run_slice(const string& csv_path,
+	       char delimiter,
+	       const string& rows,
+	       size_t read_size,
+	       size_t buffer_size,
+	       bool readahead){
+  size_t begin, end;
+  parse_row_range(rows, begin, end);
+
+  // With an up to date index, the rows are copied straight from the mapped file
+  unique_ptr<Index> idx = csv_path.empty() ? nullptr :
+    Index::load(csv_path, Index::sidecar_path(csv_path), delimiter, read_size);
+  if(idx){
+    auto print_range = [&idx](size_t from, size_t to){
+      // The last line may lack its newline
+      to = std::min(to, idx->csv_size());
+      if(from >= to) return;
+      print(idx->data() + from, to - from);
+      if(idx->data()[to-1] != NL) print(&NL, 1);
+    };
+    print_range(0, idx->line_offset(0));
+    end = std::min(end, idx->n_lines());
+    if(begin < end) print_range(idx->line_offset(begin), idx->line_offset(end));
+    return;
   }
-  
-  return r;  
-} 
 
-void run_join(Join_Mode join_mode,
-	      const string& csv_path_1,
-	      const string& csv_path_2,
-	      char delimiter_1,
-	      char delimiter_2,
-	      const vector<string>& key_columns,
-	      size_t read_size,
-	      size_t buffer_size){
-  // Read csv_2
-  unique_ptr<Csv> csv_2 = Csv::create(create_circbuf(csv_path_2,
-						     read_size,
-						     buffer_size),
-				      delimiter_2);
-  vector<string> columns_2 = csv_2->columns();
-  vector<string> empty_line_2;
-  for(size_t i=0;i<columns_2.size();i++)
-    empty_line_2.push_back("");
-  // Get keys and line numbers
-  unordered_map<string,size_t> keyed_fields_2 = keyed_fields(*csv_2,key_columns);
-
-  // Prepare buffers for reading csv_1
-  unique_ptr<Circbuf> cbuf = create_circbuf(csv_path_1,
-					    read_size,
-					    buffer_size);
-  Linescan lscan(delimiter_1, read_size);
-
-  // Read header of csv_1
+  unique_ptr<Input_Buffer> cbuf = create_buffer(csv_path, read_size, buffer_size, readahead);
+  Linescan lscan(delimiter, read_size);
   lscan.do_scan_header(cbuf->head(), read_size);
-
-  // Get columns of csv_1
-  vector<string> columns_1;
-  for(size_t i=0;i<lscan.n_fields();i++)
-    columns_1.push_back(lscan.field_str(i));
-
-  // Determine common and specific columns
-  set<string> columns_set_1 = set<string>(columns_1.begin(),columns_1.end());
-  set<string> columns_set_2 = set<string>(columns_2.begin(),columns_2.end());
-  set<string> common_columns_set = intersection_set(columns_set_1,columns_set_2);
-  vector<string> specific_columns_2 = columns_2;
-  remove_from_vec(specific_columns_2, columns_set_1);
-
-  // Find indexes of specific columns
-  vector<size_t> specific_columns_2_idxs;
-  for(const string& c:specific_columns_2)
-    specific_columns_2_idxs.push_back(find_idx(columns_2,c));
-  vector<size_t> columns_2_1_idxs;
-  for(const string& c:columns_1)
-    columns_2_1_idxs.push_back(find_idx(columns_2,c));
-
-  // Initialize printers
-  auto printer_1 = Linescan_Field_Printer(
-					  make_unique<Field_Printer>(numbers(0,columns_1.size()),
-								     delimiter_1,
-								     false, false, false));
-  auto printer_2 = Field_Printer(specific_columns_2_idxs,delimiter_1,false,true,true);
-  auto printer_2_1 = Field_Printer(columns_2_1_idxs,delimiter_1,false,false,false);
-  printer_2_1.allow_out_of_bounds(true);
-
-  // Find index of key column in csv_1
-  vector<size_t> key_cols = key_column_idxs(columns_1,key_columns);
-
-  // Print header
-  printer_1.print(lscan);
-  printer_2.print(columns_2);
-
-  // Advance to next line
+  print(lscan.begin(), lscan.length());
   cbuf->advance_head(lscan.length());
 
-  std::set<size_t> unused_line_idxs_2;
-  for(const auto& it:keyed_fields_2)
-    unused_line_idxs_2.insert(it.second);
-  
-  // Loop through lines
-  while(!cbuf->at_eof()){
-    char* head = cbuf->head();
-    lscan.do_scan(head,read_size);
-    if(lscan.length() <= 1){ // Line is empty
-      cbuf->advance_head(lscan.length());
-      continue;
-    }
+  for(size_t row=0;row<end && !cbuf->at_eof();row++){
+    lscan.do_scan_forward(cbuf->head(), read_size);
+    if(row >= begin) print(lscan.begin(), lscan.length());
+    cbuf->advance_head(lscan.length());
+  }
+}
 
-    string key = multi_key(lscan, key_cols);
+void run_sort(const string& csv_path,
+	      char delimiter,
+	      const vector<string>& columns,
+	      const vector<string>& numeric_columns,
+	      bool reverse,
+	      size_t read_size,
+	      size_t buffer_size,
+	      bool readahead,
+	      size_t max_memory,
+	      size_t threads){
+  for(const string& column:numeric_columns)
+    if(find_idx(columns, column) == columns.size())
+      throw runtime_error("Numeric column is not a sort column: " + column);
+
+  unique_ptr<Input_Buffer> cbuf = create_buffer(csv_path, read_size, buffer_size, readahead);
+  Linescan lscan(delimiter, read_size);
+  lscan.do_scan_header(cbuf->head(), read_size);
+  vector<Sort_Key> keys;
+  for(const string& column:columns){
+    bool numeric = find_idx(numeric_columns, column) < numeric_columns.size();
+    keys.push_back(Sort_Key {column_index(lscan, column),
+			     numeric ? Sort_Type::NUMERIC : Sort_Type::LEXICAL});
+  }
+  print(lscan.begin(), lscan.length());
+  cbuf->advance_head(lscan.length());
+  sort_rows(*cbuf, delimiter, lscan.crnl(), keys, reverse, max_memory, threads);
+}
 
-    { // Start Block
-      unordered_map<string,size_t>::const_iterator it = keyed_fields_2.find(key);
-      if(it == keyed_fields_2.end()){ // Key not found in csv_2
-	if(join_mode == Join_Mode::LEFT || join_mode == Join_Mode::FULL){
-	  printer_1.print(lscan);
-	  printer_2.print(empty_line_2);
-	}
-      } else {
-	size_t match_line = it->second;
-	unused_line_idxs_2.erase(match_line);
-	const vector<string>& match_fields = csv_2->fieldss()[match_line];
-	printer_1.print(lscan);
-	printer_2.print(match_fields);
-      }
-    } // End Block
+void stats_rows(Input_Buffer& cbuf, Linescan& lscan, Column_Stats& stats){
+  size_t read_size = cbuf.read_size();
+  while(!cbuf.at_eof()){
+    lscan.do_scan_forward(cbuf.head(), read_size);
+    if(lscan.length() > 1) stats.add(lscan); // Line is not empty
+    cbuf.advance_head(lscan.length());
+  }
+}
+
+/* Profiles one or more files with the same columns as if they were one
+   (STDIN if csv_paths is empty) */
+void run_stats(const vector<string>& csv_paths,
+	       char delimiter,
+	       bool approx,
+	       size_t top,
+	       size_t read_size,
+	       size_t buffer_size,
+	       bool readahead,
+	       size_t threads){
+  vector<string> columns;
+  vector<Column_Stats> stats;
+  vector<string> paths = csv_paths.empty() ? vector<string>({""}) : csv_paths;
+  for(const string& csv_path:paths){
+    unique_ptr<Input_Buffer> cbuf = create_buffer(csv_path, read_size, buffer_size, readahead);
+    Linescan lscan(delimiter, read_size);
+    lscan.do_scan_header(cbuf->head(), read_size);
+    if(stats.empty()){
+      columns = lscan.field_strs();
+      stats.assign(std::max(threads, (size_t)1), Column_Stats(columns.size(), approx, top));
+    } else if(lscan.field_strs() != columns){
+      throw runtime_error("Columns of " + csv_path + " differ from those of " + paths[0]);
+    }
     cbuf->advance_head(lscan.length());
+
+    // Every worker profiles its chunks on its own, the profiles are merged at the end
+    scan_rows(csv_path, *cbuf, lscan, delimiter, threads,
+	      [&](Input_Buffer& buf, Linescan& buf_lscan, size_t worker, FILE*){
+		stats_rows(buf, buf_lscan, stats[worker]);
+	      });
   }
+  for(size_t i=1;i<stats.size();i++) stats[0].merge(stats[i]);
+  stats[0].print(columns, delimiter);
+}
 
-  if(join_mode == Join_Mode::RIGHT || join_mode == Join_Mode::FULL){
-    for(size_t idx:unused_line_idxs_2){
-      vector<string> match_fields = csv_2->fieldss()[idx];
-      if(match_fields.size() == 1 && match_fields[0] == "") continue;
-      printer_2_1.print(match_fields);
-      printer_2.print(match_fields);
+void group_rows(Input_Buffer& cbuf, Linescan& lscan, Group_Table& table,
+		size_t max_memory, Group_Spill& spill){
+  size_t read_size = cbuf.read_size();
+  // Byte offsets order the rows; those of chunks are offsets within the file
+  Mmap_Buffer* mbuf = dynamic_cast<Mmap_Buffer*>(&cbuf);
+  uint64_t position = mbuf != nullptr ? mbuf->position() : 0;
+  while(!cbuf.at_eof()){
+    lscan.do_scan_forward(cbuf.head(), read_size);
+    if(lscan.length() > 1){ // Line is not empty
+      table.add(lscan, position);
+      if(max_memory > 0 && table.memory() > max_memory) spill.spill(table);
     }
+    position += lscan.length();
+    cbuf.advance_head(lscan.length());
+  }
+}
+
+/* Aggregates the rows by the key columns. Aggregates are given as 'count'
+   or as '<aggregate>:<column>'. Groups are written in order of their first
+   row, unless they outgrew max_memory and were spilled to partitions: then
+   the groups come out partition by partition. */
+void run_groupby(const string& csv_path,
+		 char delimiter,
+		 const vector<string>& columns,
+		 const vector<string>& agg_specs,
+		 size_t read_size,
+		 size_t buffer_size,
+		 bool readahead,
+		 size_t max_memory,
+		 size_t threads){
+  unique_ptr<Input_Buffer> cbuf = create_buffer(csv_path, read_size, buffer_size, readahead);
+  Linescan lscan(delimiter, read_size);
+  lscan.do_scan_header(cbuf->head(), read_size);
+
+  vector<size_t> key_cols;
+  for(const string& column:columns) key_cols.push_back(column_index(lscan, column));
+  vector<Aggregate> aggs;
+  for(const string& spec:agg_specs){
+    vector<string> parts = split(spec, AGG_DELIMITER);
+    if(parts.empty() || parts.size() > 2) throw runtime_error("Invalid aggregate: " + spec);
+    Agg_Type type = agg_type(parts[0]);
+    // Only count takes no column
+    if((type == Agg_Type::COUNT) != (parts.size() == 1))
+      throw runtime_error("Invalid aggregate: " + spec);
+    aggs.push_back(Aggregate {type, parts.size() == 2 ? column_index(lscan, parts[1]) : 0});
+  }
+  cbuf->advance_head(lscan.length());
+
+  vector<string> header = columns;
+  header.insert(header.end(), agg_specs.begin(), agg_specs.end());
+  for(size_t i=0;i<header.size();i++){
+    if(i > 0) putc(delimiter, stdout);
+    fputs(header[i].c_str(), stdout);
+  }
+  putc(NL, stdout);
+
+  // Every worker aggregates its chunks on its own, the tables are merged at the end
+  size_t n_workers = std::max(threads, (size_t)1);
+  size_t worker_memory = max_memory == 0 ? 0 : std::max(max_memory / n_workers, (size_t)1);
+  vector<Group_Table> tables(n_workers, Group_Table(key_cols, aggs, delimiter));
+  Group_Spill spill(max_memory == 0 ? 0 : GROUPBY_PARTITIONS);
+  scan_rows(csv_path, *cbuf, lscan, delimiter, threads,
+	    [&](Input_Buffer& buf, Linescan& buf_lscan, size_t worker, FILE*){
+	      group_rows(buf, buf_lscan, tables[worker], worker_memory, spill);
+	    });
+
+  if(!spill.spilled()){
+    for(size_t i=1;i<tables.size();i++) tables[0].merge(tables[i]);
+    tables[0].print();
+    return;
+  }
+  for(Group_Table& table:tables) spill.spill(table);
+  for(size_t p=0;p<spill.n_partitions();p++){
+    tables[0].read(spill.partition(p));
+    tables[0].print();
+    tables[0].clear();
   }
-  
 }
 
+void top_rows(Input_Buffer& cbuf, Linescan& lscan, Top_Rows& top){
+  size_t read_size = cbuf.read_size();
+  // Byte offsets order the rows; those of chunks are offsets within the file
+  Mmap_Buffer* mbuf = dynamic_cast<Mmap_Buffer*>(&cbuf);
+  uint64_t position = mbuf != nullptr ? mbuf->position() : 0;
+  while(!cbuf.at_eof()){
+    lscan.do_scan_forward(cbuf.head(), read_size);
+    if(lscan.length() > 1) top.add(lscan, position); // Line is not empty
+    position += lscan.length();
+    cbuf.advance_head(lscan.length());
+  }
+}
+
+void run_top(const string& csv_path,
+	     char delimiter,
+	     const string& column,
+	     size_t n,
+	     bool ascending,
+	     size_t read_size,
+	     size_t buffer_size,
+	     bool readahead,
+	     size_t threads){
+  unique_ptr<Input_Buffer> cbuf = create_buffer(csv_path, read_size, buffer_size, readahead);
+  Linescan lscan(delimiter, read_size);
+  lscan.do_scan_header(cbuf->head(), read_size);
+  size_t col = column_index(lscan, column);
+  print(lscan.begin(), lscan.length());
+  cbuf->advance_head(lscan.length());
+
+  // Every worker keeps the top rows of its chunks, which are merged at the end
+  vector<Top_Rows> tops(std::max(threads, (size_t)1), Top_Rows(n, col, ascending));
+  scan_rows(csv_path, *cbuf, lscan, delimiter, threads,
+	    [&](Input_Buffer& buf, Linescan& buf_lscan, size_t worker, FILE*){
+	      top_rows(buf, buf_lscan, tops[worker]);
+	    });
+  for(size_t i=1;i<tops.size();i++) tops[0].merge(tops[i]);
+  tops[0].write(stdout);
+}
+
+void run_uniq(const string& csv_path,
+	      char delimiter,
+	      const vector<string>& columns,
+	      bool exact,
+	      bool last,
+	      size_t read_size,
+	      size_t buffer_size,
+	      bool readahead,
+	      size_t max_memory){
+  unique_ptr<Input_Buffer> cbuf = create_buffer(csv_path, read_size, buffer_size, readahead);
+  Linescan lscan(delimiter, read_size);
+  lscan.do_scan_header(cbuf->head(), read_size);
+  vector<size_t> key_cols;
+  for(const string& column:columns) key_cols.push_back(column_index(lscan, column));
+  print(lscan.begin(), lscan.length());
+  cbuf->advance_head(lscan.length());
+  uniq_rows(*cbuf, delimiter, lscan.crnl(), key_cols, exact, last, max_memory);
+}
 
 int main(int argc, const char* argv[]){
   try{
@@ -450,19 +702,40 @@ int main(int argc, const char* argv[]){
     string out_columns_s;
     string join_mode = "natural";
     bool complete_match = false;
-    string csv_path_2 = "";
+    bool readahead = false;
+    size_t threads = 1;
+    vector<string> csv_paths_2;
+    string rows = ":";
+    size_t sparse_stride = 0;
+    size_t max_memory = 0;
+    bool sorted = false;
+    string build_side = "auto";
+    string numeric_s;
+    bool reverse = false;
+    vector<string> csv_paths;
+    bool approx = false;
+    size_t top = SKETCH_TOP;
+    string aggs_s = "count";
+    size_t n_rows = 10;
+    bool ascending = false;
+    bool exact = false;
+    bool last = false;
 
     app.add_option("-d,--delimiter",delimiter_str,
 		   "Column delimiter (default '" + delimiter_str + "')");
     app.add_option("--read-size",read_size,"Size of sequential buffer reads (default 16kb)")
       ->transform(CLI::AsSizeValue(false))
       ->check(CLI::PositiveNumber);
+    app.add_flag("--readahead",readahead,
+		 "Read regular files on a background thread instead of mapping them (always active for STDIN)");
 
     auto select_cmd = app.add_subcommand("select");
     select_cmd->add_option("-c,--column",columns_s,"Columns to match, separated by ','")->required();
     select_cmd->add_option("-o,--out-columns",out_columns_s,
 			  "Output columns, separated by ',' (default all)");
     select_cmd->add_flag("--complete",complete_match,"Require that fields match entirely (always active for --match)");
+    select_cmd->add_option("--threads",threads,"Number of worker threads for regular files (default 1)")
+      ->check(CLI::PositiveNumber);
     select_cmd->add_option("csv",csv_path,"CSV path");
 
     auto input_optg = select_cmd->add_option_group("match")->required();
@@ -476,13 +749,110 @@ int main(int argc, const char* argv[]){
     auto cut_cmd = app.add_subcommand("cut");
     cut_cmd->add_option("-c,--columns",out_columns_s,
 			  "Output columns, separated by ',' (default all columns)");
+    cut_cmd->add_option("--threads",threads,"Number of worker threads for regular files (default 1)")
+      ->check(CLI::PositiveNumber);
     cut_cmd->add_option("csv",csv_path,"CSV path");
 
     auto join_cmd = app.add_subcommand("join");
-    join_cmd->add_option("-c,--column",columns_s,"Columns to match, separated by ','")->required();
-    join_cmd->add_option("-m,--mode",join_mode,"Join mode (either one of 'natural,left,right,full'; default: 'natural')");
+    join_cmd->add_option("-c,--column",columns_s,
+			 "Columns to match, separated by ','. With several CSV 2 files, either one list "
+			 "for all of them or one list per file, separated by ':'")->required();
+    join_cmd->add_option("-m,--mode",join_mode,"Join mode (either one of 'natural,left,right,full,semi,anti'; default: 'natural'). "
+			 "Semi and anti joins output the rows of CSV 1 with and without a match in CSV 2");
     join_cmd->add_option("csv",csv_path,"CSV path 1");
-    join_cmd->add_option("csv_2",csv_path_2,"CSV path 2");
+    join_cmd->add_option("csv_2",csv_paths_2,
+			 "CSV path 2; several files are joined to CSV 1 one after the other in a single pass");
+    join_cmd->add_option("--threads",threads,"Number of worker threads for regular files (default 1)")
+      ->check(CLI::PositiveNumber);
+    auto max_memory_opt = join_cmd->add_option("--max-memory",max_memory,
+			 "Memory budget for the hash table; larger tables are joined in partitions "
+			 "through temporary files (default: unlimited)")
+      ->transform(CLI::AsSizeValue(false));
+    auto sorted_opt = join_cmd->add_flag("--sorted",sorted,
+		       "Both CSV files are sorted by the key columns (as bytes); "
+		       "merge them while streaming instead of building a hash table")
+      ->excludes(max_memory_opt);
+    join_cmd->add_option("--build-side",build_side,
+			 "CSV file to build the hash table on (either one of 'auto,1,2'; default: 'auto'). "
+			 "With --max-memory, 'auto' builds on CSV 1 if its table is smaller. Built on "
+			 "CSV 1, rows come out in the order of CSV 2. Semi and anti joins and several "
+			 "CSV 2 files build on CSV 2")
+      ->excludes(sorted_opt);
+
+    auto sort_cmd = app.add_subcommand("sort");
+    sort_cmd->add_option("-c,--columns",columns_s,"Columns to sort by, separated by ','")->required();
+    sort_cmd->add_option("-n,--numeric",numeric_s,
+			 "Sort columns compared as numbers, separated by ','; fields that are not numbers "
+			 "come first (default: compare all as bytes)");
+    sort_cmd->add_flag("-r,--reverse",reverse,"Sort in descending order; equal rows keep their order");
+    sort_cmd->add_option("--max-memory",max_memory,
+			 "Memory budget for sorted runs; larger inputs are merged from temporary files "
+			 "(default: unlimited)")
+      ->transform(CLI::AsSizeValue(false));
+    sort_cmd->add_option("--threads",threads,"Number of worker threads (default 1)")
+      ->check(CLI::PositiveNumber);
+    sort_cmd->add_option("csv",csv_path,"CSV path");
+
+    auto stats_cmd = app.add_subcommand("stats");
+    stats_cmd->add_option("--threads",threads,"Number of worker threads for regular files (default 1)")
+      ->check(CLI::PositiveNumber);
+    stats_cmd->add_flag("--approx",approx,
+			"Also estimate the distinct values and the most frequent values of every column, "
+			"in fixed memory per column");
+    stats_cmd->add_option("--top",top,
+			  "Number of most frequent values listed with --approx (default " +
+			  to_string(top) + ")");
+    stats_cmd->add_option("csv",csv_paths,"CSV paths; several files with the same columns are profiled together");
+
+    auto groupby_cmd = app.add_subcommand("groupby");
+    groupby_cmd->add_option("-c,--columns",columns_s,"Key columns to group by, separated by ','")->required();
+    groupby_cmd->add_option("-a,--agg",aggs_s,
+			    "Aggregates, separated by ',': 'count' or one of 'sum,min,max,mean' and a column, "
+			    "as in 'sum:amount'; fields that are not numbers are left out (default: count)");
+    groupby_cmd->add_option("--max-memory",max_memory,
+			    "Memory budget for the groups; more groups are spilled to temporary files "
+			    "and written partition by partition instead of in input order (default: unlimited)")
+      ->transform(CLI::AsSizeValue(false));
+    groupby_cmd->add_option("--threads",threads,"Number of worker threads for regular files (default 1)")
+      ->check(CLI::PositiveNumber);
+    groupby_cmd->add_option("csv",csv_path,"CSV path");
+
+    auto top_cmd = app.add_subcommand("top");
+    top_cmd->add_option("-c,--column",columns_s,"Numeric column to rank the rows by")->required();
+    top_cmd->add_option("-n,--rows",n_rows,
+			"Number of rows with the largest numbers to print, largest first; rows that are "
+			"not numbers in the column are skipped, ties keep their input order (default " +
+			to_string(n_rows) + ")");
+    top_cmd->add_flag("--asc",ascending,"Print the rows with the smallest numbers instead, smallest first");
+    top_cmd->add_option("--threads",threads,"Number of worker threads for regular files (default 1)")
+      ->check(CLI::PositiveNumber);
+    top_cmd->add_option("csv",csv_path,"CSV path");
+
+    auto uniq_cmd = app.add_subcommand("uniq");
+    uniq_cmd->add_option("-c,--columns",columns_s,"Key columns, separated by ','")->required();
+    uniq_cmd->add_flag("--last",last,"Keep the last row of every key instead of the first");
+    uniq_cmd->add_flag("--exact",exact,
+		       "Compare the keys themselves instead of only their 64 bit fingerprints, "
+		       "at the cost of keeping a copy of every key");
+    uniq_cmd->add_option("--max-memory",max_memory,
+			 "Memory budget for the keys (and the rows kept with --last); beyond it, rows are "
+			 "deduplicated in partitions through temporary files (default: unlimited)")
+      ->transform(CLI::AsSizeValue(false));
+    uniq_cmd->add_option("csv",csv_path,"CSV path");
+
+    auto slice_cmd = app.add_subcommand("slice");
+    slice_cmd->add_option("-r,--rows",rows,
+			  "Range of rows 'A:B' (0-based, excluding B and the header; default all)");
+    slice_cmd->add_option("csv",csv_path,"CSV path");
+
+    auto index_cmd = app.add_subcommand("index");
+    index_cmd->add_option("csv",csv_path,"CSV path (the index is written to <csv>" + INDEX_SUFFIX + ")")
+      ->required();
+    index_cmd->add_option("--sparse",sparse_stride,
+			  "Only keep the start of every N-th row; lookups scan up to N rows (default: index every field)")
+      ->check(CLI::PositiveNumber);
+    index_cmd->add_option("--threads",threads,"Number of worker threads (default 1)")
+      ->check(CLI::PositiveNumber);
 
     app.require_subcommand(1);
     CLI11_PARSE(app, argc, argv);
@@ -498,19 +868,41 @@ int main(int argc, const char* argv[]){
     if(select_cmd->parsed()){
       run_select(csv_path, columns, regexes, matches,
 		 complete_match, delimiter,
-		 out_columns, 0, read_size, buffer_size);
+		 out_columns, 0, read_size, buffer_size, readahead, threads);
     } else if(cut_cmd->parsed()){
-      run_cut(csv_path, delimiter, out_columns, read_size, buffer_size);
+      run_cut(csv_path, delimiter, out_columns, read_size, buffer_size, readahead, threads);
     } else if(join_cmd->parsed()){
-      if(csv_path_2.empty()){
-	csv_path_2 = csv_path;
+      if(csv_paths_2.empty()){
+	csv_paths_2.push_back(csv_path);
 	csv_path = "";
       }
+      vector<vector<string>> key_columns = parse_key_lists(columns_s, csv_paths_2.size());
 
       map<string,Join_Mode>::const_iterator it = JOIN_MODES.find(join_mode);
       if(it == JOIN_MODES.end()) throw runtime_error("Unknown join mode");
       Join_Mode join_mode_parsed = it->second;
-      run_join(join_mode_parsed, csv_path,csv_path_2, delimiter, delimiter, columns, read_size, buffer_size);
+      map<string,Build_Side>::const_iterator side_it = BUILD_SIDES.find(build_side);
+      if(side_it == BUILD_SIDES.end()) throw runtime_error("Unknown build side");
+      run_join(join_mode_parsed, csv_path,csv_paths_2, delimiter, delimiter, key_columns,
+	       read_size, buffer_size, readahead, max_memory, sorted, side_it->second, threads);
+    } else if(sort_cmd->parsed()){
+      run_sort(csv_path, delimiter, columns, split(numeric_s,ARG_DELIMITER), reverse,
+	       read_size, buffer_size, readahead, max_memory, threads);
+    } else if(stats_cmd->parsed()){
+      run_stats(csv_paths, delimiter, approx, top, read_size, buffer_size, readahead, threads);
+    } else if(groupby_cmd->parsed()){
+      run_groupby(csv_path, delimiter, columns, split(aggs_s,ARG_DELIMITER),
+		  read_size, buffer_size, readahead, max_memory, threads);
+    } else if(top_cmd->parsed()){
+      run_top(csv_path, delimiter, columns_s, n_rows, ascending,
+	      read_size, buffer_size, readahead, threads);
+    } else if(uniq_cmd->parsed()){
+      run_uniq(csv_path, delimiter, columns, exact, last,
+	       read_size, buffer_size, readahead, max_memory);
+    } else if(slice_cmd->parsed()){
+      run_slice(csv_path, delimiter, rows, read_size, buffer_size, readahead);
+    } else if(index_cmd->parsed()){
+      run_index(csv_path, delimiter, read_size, sparse_stride, threads);
     } else {
       throw runtime_error("Unknown subcommand");
     }
@@ -1,6 +1,11 @@
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <map>
 #include <string>
@@ -13,11 +18,76 @@
 
 #include <csv/st.hpp>
 #include <csv/match.hpp>
+#include <csv/parallel.hpp>
 
 using namespace std;
 using namespace st;
 using namespace csv;
 
+unique_ptr<Mmap_Buffer> Mmap_Buffer::create(const string& csv_path, size_t read_size){
+  return Mmap_Buffer::create(csv_path, read_size, 0, string::npos);
+}
+
+unique_ptr<Mmap_Buffer> Mmap_Buffer::create(const string& csv_path, size_t read_size,
+					    size_t offset, size_t size){
+  int fd = open(csv_path.c_str(), O_RDONLY);
+  if(fd < 0) throw runtime_error("Could not open " + csv_path + ": " + strerror(errno));
+  struct stat st;
+  if(fstat(fd, &st) != 0) { // LCOV_EXCL_START
+    close(fd);
+    throw runtime_error("Could not stat " + csv_path + ": " + strerror(errno));
+  } // LCOV_EXCL_STOP
+  size_t file_size = st.st_size;
+  offset = std::min(offset, file_size);
+  size = std::min(size, file_size - offset);
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  auto round_up = [page_size](size_t n){ return (n + page_size - 1) / page_size * page_size; };
+  size_t map_offset = offset / page_size * page_size;
+  size_t lead_size = offset - map_offset;
+  size_t end = offset + size;
+  size_t end_page = std::max(map_offset, end / page_size * page_size);
+  size_t prefix_size = round_up(read_size);
+  size_t map_size = prefix_size + round_up(lead_size + size) + round_up(read_size + 1);
+
+  // Reserve zeroed memory for the guard areas, then place the file in between
+  void* map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(map == MAP_FAILED) { // LCOV_EXCL_START
+    close(fd);
+    throw runtime_error("Could not reserve memory for " + csv_path + ": " + strerror(errno));
+  } // LCOV_EXCL_STOP
+  char* base = (char*)map + prefix_size;
+  if(end_page > map_offset){
+    void* data = mmap(base, end_page - map_offset, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_FIXED, fd, map_offset);
+    if(data == MAP_FAILED) { // LCOV_EXCL_START
+      munmap(map, map_size);
+      close(fd);
+      throw runtime_error("Could not map " + csv_path + ": " + strerror(errno));
+    } // LCOV_EXCL_STOP
+    madvise(data, end_page - map_offset, MADV_SEQUENTIAL);
+  }
+  // The last partial page is copied, so that bytes behind the range stay \0
+  size_t copied = 0;
+  while(end_page + copied < end){
+    ssize_t n = pread(fd, base + (end_page - map_offset) + copied,
+		      end - end_page - copied, end_page + copied);
+    if(n < 0 && errno == EINTR) continue; // LCOV_EXCL_LINE
+    if(n <= 0) { // LCOV_EXCL_START
+      munmap(map, map_size);
+      close(fd);
+      throw runtime_error("Could not read " + csv_path);
+    } // LCOV_EXCL_STOP
+    copied += n;
+  }
+  close(fd);
+  char* begin = base + lead_size;
+  if(begin[-1] != NL) begin[-1] = NL;
+
+  return make_unique<Mmap_Buffer>((char*)map, map_size, offset, begin, size, read_size);
+}
+
 const char* csv::Linescan::field(size_t idx) const {
   if(idx >= _n_fields) return nullptr;
   return _begin + _offsets[idx];  
@@ -28,6 +98,20 @@ size_t csv::Linescan::field_size(size_t idx) const {
   return _offsets[idx+1] - _offsets[idx] - 1;
 }
 
+vector<string> csv::Linescan::field_strs() const {
+  vector<string> r;
+  for(size_t i=0;i<_n_fields;i++)
+    r.push_back(field_str(i));
+  return r;
+}
+
+string_view csv::Linescan::row(string& scratch) const {
+  if(!_crnl || _begin[_length-2] == '\r') return string_view(_begin, _length);
+  scratch.assign(_begin, _length - 1);
+  scratch += "\r\n";
+  return scratch;
+}
+
 string csv::Linescan::str() const {
   ostringstream s;
   s << "Begin: " << str_ptr(_begin) // lcov bug; LCOV_EXCL_LINE 				
@@ -44,51 +128,57 @@ void csv::Linescan::do_scan(const char* b, size_t n){
 
   const char* nl_left;
   {
-    int rc = linescan_rfind(b-n,_delimiter_mask,n,_lscan);
+    _left_distances.clear();
+    size_t distance = rfind_fields(b,n,_delimiter,_left_distances);
     
-    if(rc < 1) throw runtime_error("Could not find left newline. Maybe --read-size is too small.");
-    size_t offset = _lscan->offsets[_lscan->offsets_n-1];
+    if(distance == 0) throw runtime_error("Could not find left newline. Maybe --read-size is too small.");
   
-    nl_left = _lscan->buf + offset;
-    for(int i=_lscan->offsets_n-1;i>=1;i--){
-      _offsets.push_back(_lscan->offsets[i]-offset);    
+    nl_left = b - distance;
+    _offsets.push_back(0);
+    for(size_t i=_left_distances.size();i>0;i--){
+      _offsets.push_back(distance - _left_distances[i-1]);
     }
 
     _begin = nl_left + 1;
     _match_field = _offsets.size() - 1;
   }
 
-  const char* nl_right;
-  {
-    int rc = linescan_find(b,_delimiter_mask,n,_lscan); 
-
-    if(rc > 0) {
-      nl_right = _lscan->buf + _lscan->size - 1;
-    } else if(rc == 0) {
-      char* nl = simple_scan_right(b,n,'\0');
-      if(nl==nullptr) throw runtime_error("Could not find right newline. Maybe --read-size is too small");
-      nl[0] = NL;
-      nl_right = nl;
-      _lscan->offsets[_lscan->offsets_n] = nl_right - b;
-      _lscan->offsets_n++;
-    } else { // LCOV_EXCL_START
-      // rc < 0 is reserved for general errors
-      throw runtime_error("Linescan: Unknown error."); 
-    } // LCOV_EXCL_STOP
-    _length = nl_right - nl_left;
+  this->scan_right(b,n,nl_left);
+  return;
+}
 
-    size_t offset = b - nl_left;
-    for(size_t i=1;i<_lscan->offsets_n;i++){
-      _offsets.push_back(_lscan->offsets[i]+offset);    
-    }
+void csv::Linescan::do_scan_forward(const char* b, size_t n){
+  this->reset();
+  assert(b[-1] == NL);
 
-    if(rc > 0 && _crnl) this->adjust_for_crnl();
+  _begin = b;
+  _offsets.push_back(0);
+  this->scan_right(b,n,b-1);
+  return;
+}
+
+void csv::Linescan::scan_right(const char* b, size_t n, const char* nl_left){
+  const char* nl_right;
+  size_t offset = b - nl_left;
+  size_t pos = find_fields(b,n,_delimiter,_offsets,offset);
+  bool found = pos < n;
+
+  if(found) {
+    nl_right = b + pos;
+  } else {
+    char* nl = simple_scan_right(b,n,'\0');
+    if(nl==nullptr) throw runtime_error("Could not find right newline. Maybe --read-size is too small");
+    nl[0] = NL;
+    nl_right = nl;
   }
+  _offsets.push_back(nl_right - nl_left);
+  _length = nl_right - nl_left;
 
-  assert(_lscan->offsets_n <= _offsets_size);
+  if(found && _crnl) this->adjust_for_crnl();
+
+  assert(_offsets.size() <= _offsets_size + 1);
 
   _n_fields = _offsets.size() - 1;
-  return;
 }
 
 void csv::Linescan::do_scan_header(const char* buf, size_t n){
@@ -96,7 +186,7 @@ void csv::Linescan::do_scan_header(const char* buf, size_t n){
   
   if(buf[-1] != '\n') throw runtime_error("No left newline found in header");
 
-  this->do_scan(buf,n);
+  this->do_scan_forward(buf,n);
 
   if((this->begin() + this->length()-2)[0] == '\r'){
     this->set_crnl(true);
@@ -142,7 +232,7 @@ bool csv::Boyer_Moore_Matcher::do_search(const char* begin, size_t n){
   return r.first != r.second;
 }
 
-bool csv::Multiline_BMatcher::do_search(Circbuf& c, Linescan& result){
+bool csv::Multiline_BMatcher::do_search(Input_Buffer& c, Linescan& result){
   const char* head = c.advance_head(_advance_next);
   size_t read_size = c.read_size();
 
@@ -216,42 +306,129 @@ bool csv::Singleline_BMatcher::match(const Linescan& lscan){
   return match && is_complete;
 }
 
-bool csv::Singleline_BMatcher::do_search(Circbuf& c, Linescan& result){
+bool csv::Singleline_BMatcher::do_search(Input_Buffer& c, Linescan& result){
   size_t read_size = c.read_size();
   const char* head = c.advance_head(_advance_next);
   if(c.at_eof()) return false;
-  result.do_scan(head,read_size);
+  result.do_scan_forward(head,read_size);
 
   bool match = this->match(result);
   _advance_next = result.length();
   return match;  
 }
 
-unique_ptr<Csv> Csv::create(unique_ptr<Circbuf> cbuf, char delimiter){
+namespace {
+  // Rows of one newline-aligned range of a mapped file, relative to the range
+  struct Csv_Chunk {
+    vector<size_t> row_starts;
+    vector<uint32_t> offsets;
+    vector<size_t> offset_starts;
+    size_t end = 0;
+  };
+
+  void scan_chunk(const char* begin, const char* end, char delimiter, bool crnl,
+		  size_t read_size, Csv_Chunk& chunk){
+    Linescan lscan(delimiter, read_size);
+    lscan.set_crnl(crnl);
+    const char* p = begin;
+    while(p < end){
+      lscan.do_scan_forward(p, read_size);
+      chunk.row_starts.push_back(p - begin);
+      chunk.offset_starts.push_back(chunk.offsets.size());
+      const vector<size_t>& offsets = lscan.offsets();
+      chunk.offsets.insert(chunk.offsets.end(), offsets.begin(), offsets.end());
+      p += lscan.length();
+    }
+    chunk.end = p - begin;
+  }
+}
+
+unique_ptr<Csv> Csv::create(unique_ptr<Input_Buffer> cbuf, char delimiter, size_t threads){
   size_t read_size = cbuf->read_size();
   Linescan lscan(delimiter, read_size);
   lscan.do_scan_header(cbuf->head(), read_size);
 
-  auto columns = make_unique<vector<string>>();
-  auto fieldss = make_unique<vector<vector<string>>>();
-  for(size_t i=0;i<lscan.n_fields();i++)
-    columns->push_back(lscan.field_str(i));
+  unique_ptr<Csv> r = make_unique<Csv>(lscan.field_strs());
   cbuf->advance_head(lscan.length());
-  
-  while(!cbuf->at_eof()){
-    char* head = cbuf->head();
-    lscan.do_scan(head,read_size);
-    vector<string> fields;
-    for(size_t i=0;i<lscan.n_fields();i++)
-      fields.push_back(lscan.field_str(i));
-    fieldss->push_back(fields);
-    cbuf->advance_head(lscan.length());
+
+  // Mapped files tell their size up front
+  Mmap_Buffer* mbuf = dynamic_cast<Mmap_Buffer*>(cbuf.get());
+  if(threads <= 1 || mbuf == nullptr || mbuf->remaining() == 0){
+    if(mbuf != nullptr) r->_arena.reserve(mbuf->remaining());
+    while(!cbuf->at_eof()){
+      lscan.do_scan_forward(cbuf->head(),read_size);
+      r->append(lscan);
+      cbuf->advance_head(lscan.length());
+    }
+    return r;
   }
 
-  unique_ptr<Csv> r = make_unique<Csv>(std::move(columns),std::move(fieldss));
+  /* Every chunk is scanned where it is mapped. The arena is a verbatim copy
+     of the rows, so each chunk then copies its bytes and shifted offsets into
+     its own part of the result. */
+  const char* head = mbuf->head();
+  vector<size_t> splits = split_lines(head, mbuf->remaining(),
+				      chunk_count(mbuf->remaining(), threads));
+  size_t n_chunks = splits.size() - 1;
+  vector<Csv_Chunk> chunks(n_chunks);
+  run_parallel(n_chunks, threads, [&](size_t c, size_t){
+				    scan_chunk(head + splits[c], head + splits[c+1], delimiter,
+					       lscan.crnl(), read_size, chunks[c]);
+				  });
+
+  vector<size_t> row_bases {0}, offset_bases {0};
+  for(const Csv_Chunk& chunk:chunks){
+    row_bases.push_back(row_bases.back() + chunk.row_starts.size());
+    offset_bases.push_back(offset_bases.back() + chunk.offsets.size());
+  }
+  r->_arena.resize(splits[n_chunks-1] + chunks[n_chunks-1].end);
+  r->_row_starts.resize(row_bases.back());
+  r->_offsets.resize(offset_bases.back());
+  r->_offset_starts.resize(row_bases.back() + 1);
+  run_parallel(n_chunks, threads, [&](size_t c, size_t){
+				    Csv_Chunk& chunk = chunks[c];
+				    memcpy(r->_arena.data() + splits[c], head + splits[c], chunk.end);
+				    copy(chunk.offsets.begin(), chunk.offsets.end(),
+					 r->_offsets.begin() + offset_bases[c]);
+				    for(size_t i=0;i<chunk.row_starts.size();i++){
+				      r->_row_starts[row_bases[c] + i] = splits[c] + chunk.row_starts[i];
+				      r->_offset_starts[row_bases[c] + i + 1] =
+					offset_bases[c] + (i + 1 < chunk.offset_starts.size() ?
+							   chunk.offset_starts[i+1] : chunk.offsets.size());
+				    }
+				    chunk = Csv_Chunk();
+				  });
   return r;
 }
 
+void Csv::append(const Linescan& lscan){
+  _row_starts.push_back(_arena.size());
+  _arena.insert(_arena.end(), lscan.begin(), lscan.begin() + lscan.length());
+  const vector<size_t>& offsets = lscan.offsets();
+  _offsets.insert(_offsets.end(), offsets.begin(), offsets.end());
+  _offset_starts.push_back(_offsets.size());
+}
+
+void Csv::append(const Linescan& lscan, const vector<size_t>& fields){
+  size_t row_start = _arena.size();
+  _row_starts.push_back(row_start);
+  _offsets.push_back(0);
+  for(size_t field:fields){
+    string_view f = lscan.field_view(field);
+    _arena.insert(_arena.end(), f.begin(), f.end());
+    _arena.push_back(NL);
+    _offsets.push_back(_arena.size() - row_start);
+  }
+  _offset_starts.push_back(_offsets.size());
+}
+
+void Csv::clear(){
+  _arena.clear();
+  _row_starts.clear();
+  _offsets.clear();
+  _offset_starts.resize(1);
+}
+
 bool csv::contains_special_chars(const string& regex){
   bool match = false;
   for(const char& c: ".[]{}()\\*+?|^$") {
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+
+#include <csv/parallel.hpp>
+
+using namespace std;
+using namespace csv;
+
+size_t csv::chunk_count(size_t size, size_t n_threads){
+  return std::max(n_threads * PARALLEL_CHUNKS_PER_THREAD, size / PARALLEL_CHUNK_SIZE + 1);
+}
+
+vector<size_t> csv::split_lines(const char* begin, size_t size, size_t n_chunks){
+  vector<size_t> r {0};
+  for(size_t i=1;i<n_chunks;i++){
+    size_t target = std::max(r.back(), size / n_chunks * i);
+    if(target >= size) break;
+    const char* nl = (const char*)memchr(begin + target, NL, size - target);
+    if(nl == nullptr) break;
+    size_t boundary = nl - begin + 1;
+    if(boundary >= size) break;
+    if(boundary > r.back()) r.push_back(boundary);
+  }
+  r.push_back(size);
+  return r;
+}
+
+namespace {
+  struct Chunk_Output {
+    char* bytes = nullptr;
+    size_t size = 0;
+    bool done = false;
+  };
+}
+
+void csv::run_ordered(size_t n_chunks, size_t n_threads,
+		      const function<void(size_t,size_t,FILE*)>& work,
+		      FILE* out){
+  const size_t max_pending = n_threads * PARALLEL_CHUNKS_PER_THREAD;
+  vector<Chunk_Output> outputs(n_chunks);
+  size_t next = 0;
+  size_t written = 0;
+  exception_ptr error;
+  mutex m;
+  condition_variable cv;
+
+  auto worker = [&](size_t worker_idx){
+		  while(true){
+		    size_t chunk;
+		    {
+		      unique_lock<mutex> lock(m);
+		      cv.wait(lock, [&]{ return error || next < written + max_pending; });
+		      if(error || next >= n_chunks) return;
+		      chunk = next++;
+		    }
+		    Chunk_Output o;
+		    FILE* chunk_out = open_memstream(&o.bytes, &o.size);
+		    if(chunk_out == nullptr) { // LCOV_EXCL_START
+		      lock_guard<mutex> lock(m);
+		      if(!error) error = make_exception_ptr(runtime_error("Could not allocate output buffer"));
+		      cv.notify_all();
+		      return;
+		    } // LCOV_EXCL_STOP
+		    try {
+		      work(chunk, worker_idx, chunk_out);
+		      fclose(chunk_out);
+		    } catch(...) {
+		      fclose(chunk_out);
+		      free(o.bytes);
+		      lock_guard<mutex> lock(m);
+		      if(!error) error = current_exception();
+		      cv.notify_all();
+		      return;
+		    }
+		    o.done = true;
+		    {
+		      lock_guard<mutex> lock(m);
+		      outputs[chunk] = o;
+		    }
+		    cv.notify_all();
+		  }
+		};
+
+  vector<thread> threads;
+  for(size_t i=0;i<n_threads;i++)
+    threads.emplace_back(worker, i);
+
+  for(size_t i=0;i<n_chunks;i++){
+    Chunk_Output o;
+    {
+      unique_lock<mutex> lock(m);
+      cv.wait(lock, [&]{ return error || outputs[i].done; });
+      if(error) break;
+      o = outputs[i];
+    }
+    fwrite(o.bytes, sizeof(char), o.size, out);
+    free(o.bytes);
+    {
+      lock_guard<mutex> lock(m);
+      outputs[i].bytes = nullptr;
+      written++;
+    }
+    cv.notify_all();
+  }
+
+  for(thread& t:threads) t.join();
+  for(Chunk_Output& o:outputs) free(o.bytes);
+  if(error) rethrow_exception(error);
+}
+
+void csv::run_parallel(size_t n_chunks, size_t n_threads,
+		       const function<void(size_t,size_t)>& work){
+  atomic<size_t> next {0};
+  atomic<bool> failed {false};
+  exception_ptr error;
+  mutex m;
+
+  auto worker = [&](size_t worker_idx){
+		  while(!failed.load()){
+		    size_t chunk = next++;
+		    if(chunk >= n_chunks) return;
+		    try {
+		      work(chunk, worker_idx);
+		    } catch(...) {
+		      lock_guard<mutex> lock(m);
+		      if(!error) error = current_exception();
+		      failed.store(true);
+		      return;
+		    }
+		  }
+		};
+
+  vector<thread> threads;
+  for(size_t i=0;i<n_threads;i++)
+    threads.emplace_back(worker, i);
+  for(thread& t:threads) t.join();
+  if(error) rethrow_exception(error);
+}
+
+void csv::scan_rows(const string& csv_path,
+		    Input_Buffer& cbuf,
+		    Linescan& lscan,
+		    char delimiter,
+		    size_t threads,
+		    const function<void(Input_Buffer&,Linescan&,size_t,FILE*)>& scan,
+		    FILE* out){
+  Mmap_Buffer* mbuf = dynamic_cast<Mmap_Buffer*>(&cbuf);
+  if(threads <= 1 || mbuf == nullptr){
+    scan(cbuf, lscan, 0, out);
+    return;
+  }
+
+  size_t read_size = cbuf.read_size();
+  size_t position = mbuf->position();
+  vector<size_t> splits = split_lines(mbuf->head(), mbuf->remaining(),
+				      chunk_count(mbuf->remaining(), threads));
+  bool crnl = lscan.crnl();
+  run_ordered(splits.size() - 1, threads,
+	      [&](size_t chunk, size_t worker, FILE* chunk_out){
+		unique_ptr<Mmap_Buffer> chunk_buf =
+		  Mmap_Buffer::create(csv_path, read_size,
+				      position + splits[chunk],
+				      splits[chunk+1] - splits[chunk]);
+		Linescan chunk_lscan(delimiter, read_size);
+		chunk_lscan.set_crnl(crnl);
+		scan(*chunk_buf, chunk_lscan, worker, chunk_out);
+	      }, out);
+}
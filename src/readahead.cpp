@@ -0,0 +1,131 @@
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include <csv/readahead.hpp>
+
+using namespace std;
+using namespace csv;
+
+static FILE* open_or_throw(const string& csv_path){
+  FILE* fd = fopen(csv_path.c_str(),"r");
+  if(fd == nullptr) throw runtime_error("Could not open " + csv_path + ": " + strerror(errno));
+  return fd;
+}
+
+csv::Readahead_Buffer::Readahead_Buffer(FILE* fd, size_t read_size, size_t buffer_size) :
+  _read_size {read_size},
+  _block_size {std::max(read_size, buffer_size / READAHEAD_BLOCKS)},
+  _n_blocks {READAHEAD_BLOCKS},
+  _window_size {_block_size + 2 * read_size},
+  _blocks {new char[_n_blocks * _block_size]},
+  _block_lengths {new size_t[_n_blocks]()},
+  _window {new char[_window_size]()},
+  _fd {fd},
+  _finished {false},
+  _produced {0}, _consumed {0},
+  _eof {false}, _stop {false}, _error {0},
+  _reader_waiting {false}, _scanner_waiting {false}
+{
+  _window[read_size-1] = NL;
+  _head = _window.get() + read_size;
+  _end = _head;
+  _reader = std::thread(&Readahead_Buffer::read_loop, this);
+  try {
+    refill();
+  } catch(...) { // LCOV_EXCL_START
+    _reader.join();
+    throw;
+  } // LCOV_EXCL_STOP
+}
+
+csv::Readahead_Buffer::Readahead_Buffer(const string& csv_path, size_t read_size,
+					size_t buffer_size) :
+  Readahead_Buffer(open_or_throw(csv_path), read_size, buffer_size) {}
+
+csv::Readahead_Buffer::~Readahead_Buffer(){
+  _stop.store(true);
+  { lock_guard<mutex> lock(_mutex); }
+  _cv.notify_all();
+  // A reader waiting for input notices _stop within POLL_TIMEOUT
+  _reader.join();
+  fclose(_fd);
+}
+
+void csv::Readahead_Buffer::read_loop(){
+  int fd = fileno(_fd);
+  size_t produced = 0;
+  while(!_stop.load()){
+    park(_reader_waiting, [this, produced]{
+			    return _stop.load() || produced - _consumed.load() < _n_blocks;
+			  });
+    if(_stop.load()) return;
+
+    /* Only read once there is input, so that a pipe or terminal without
+       any does not keep the reader from seeing _stop */
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int rc = poll(&pfd, 1, POLL_TIMEOUT);
+    if(rc == 0 || (rc < 0 && errno == EINTR)) continue;
+
+    size_t slot = produced % _n_blocks;
+    ssize_t n = rc < 0 ? rc : read(fd, _blocks.get() + slot * _block_size, _block_size);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0){
+      if(n < 0) _error.store(errno); // LCOV_EXCL_LINE
+      _eof.store(true);
+      unpark(_scanner_waiting);
+      return;
+    }
+    _block_lengths[slot] = n;
+    produced++;
+    _produced.store(produced);
+    unpark(_scanner_waiting);
+  }
+}
+
+bool csv::Readahead_Buffer::take_block(){
+  size_t consumed = _consumed.load(memory_order_relaxed);
+  park(_scanner_waiting, [this, consumed]{
+			   return _produced.load() > consumed || _eof.load();
+			 });
+  // _eof is only set after the last block was published
+  if(_produced.load() == consumed) return false;
+
+  size_t slot = consumed % _n_blocks;
+  size_t n = _block_lengths[slot];
+  memcpy(_end, _blocks.get() + slot * _block_size, n);
+  _end += n;
+  _consumed.store(consumed + 1);
+  unpark(_reader_waiting);
+  return true;
+}
+
+void csv::Readahead_Buffer::compact(){
+  // Keep read_size bytes left of the head for backward scans
+  char* window = _window.get();
+  char* from = _head - _read_size;
+  size_t keep = _end > from ? _end - from : 0;
+  memmove(window, from, keep);
+  _head = window + _read_size;
+  _end = window + keep;
+  if(_finished) memset(_end, 0, _window_size - keep);
+}
+
+void csv::Readahead_Buffer::refill(){
+  char* window_end = _window.get() + _window_size;
+  while(!_finished && _end < _head + _read_size){
+    if((size_t)(window_end - _end) < _block_size) {
+      compact();
+    }
+    if(!take_block()){
+      _finished = true;
+      memset(_end, 0, window_end - _end);
+      int error = _error.load();
+      if(error != 0) throw runtime_error(string("Read error: ") + strerror(error)); // LCOV_EXCL_LINE
+    }
+  }
+  if(_head + _read_size > window_end) compact();
+}
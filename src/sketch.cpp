@@ -0,0 +1,137 @@
+#include <math.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <csv/sketch.hpp>
+
+using namespace std;
+using namespace csv;
+
+void csv::Hyper_Log_Log::merge(const Hyper_Log_Log& o){
+  if(o._bits != _bits) throw runtime_error("Cannot merge sketches of different sizes");
+  for(size_t i=0;i<_registers.size();i++)
+    _registers[i] = std::max(_registers[i], o._registers[i]);
+}
+
+double csv::Hyper_Log_Log::estimate() const {
+  double m = _registers.size();
+  double sum = 0;
+  size_t zeros = 0;
+  for(uint8_t r:_registers){
+    sum += ldexp(1.0, -r);
+    if(r == 0) zeros++;
+  }
+  double alpha = 0.7213 / (1 + 1.079 / m);
+  double e = alpha * m * m / sum;
+  // Few distinct values leave registers empty, which linear counting takes into account
+  if(e <= 2.5 * m && zeros > 0) e = m * log(m / zeros);
+  return e;
+}
+
+csv::Top_Values::Top_Values(size_t k, size_t width) :
+  _k {k}, _capacity {k * SKETCH_TOP_CANDIDATES}, _width_bits {0}, _counts (SKETCH_CMS_DEPTH * width, 0)
+{
+  while(((size_t)2 << _width_bits) <= width) _width_bits++;
+}
+
+uint64_t csv::Top_Values::estimate(uint64_t h) const {
+  uint64_t r = UINT64_MAX;
+  for(size_t row=0;row<SKETCH_CMS_DEPTH;row++) r = std::min(r, _counts[counter(row, h)]);
+  return r;
+}
+
+void csv::Top_Values::swap_candidates(size_t i, size_t j){
+  std::swap(_candidates[i], _candidates[j]);
+  _positions[_candidates[i].hash] = i;
+  _positions[_candidates[j].hash] = j;
+}
+
+void csv::Top_Values::sift_up(size_t i){
+  while(i > 0 && _candidates[i].count < _candidates[(i-1)/2].count){
+    swap_candidates(i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+void csv::Top_Values::sift_down(size_t i){
+  size_t n = _candidates.size();
+  while(true){
+    size_t min = i;
+    for(size_t child:{2*i+1, 2*i+2})
+      if(child < n && _candidates[child].count < _candidates[min].count) min = child;
+    if(min == i) return;
+    swap_candidates(i, min);
+    i = min;
+  }
+}
+
+void csv::Top_Values::offer(uint64_t h, string_view value, uint64_t count){
+  unordered_map<uint64_t,size_t>::iterator it = _positions.find(h);
+  if(it != _positions.end()){
+    // Values of equal hashes share their counters, so the first one stands for all
+    Candidate& c = _candidates[it->second];
+    if(c.value != value) return;
+    c.count = count;
+    sift_down(it->second);
+    return;
+  }
+  if(_candidates.size() < _capacity){
+    _candidates.push_back(Candidate {h, string(value), count});
+    _positions[h] = _candidates.size() - 1;
+    sift_up(_candidates.size() - 1);
+    return;
+  }
+  // Replaces the smallest candidate, which add made sure is smaller than count
+  Candidate& min = _candidates[0];
+  _positions.erase(min.hash);
+  min.hash = h;
+  min.value.assign(value);
+  min.count = count;
+  _positions[h] = 0;
+  sift_down(0);
+}
+
+void csv::Top_Values::add(string_view value, uint64_t h){
+  // Conservative update: only the smallest counters, which bound the count, grow
+  uint64_t count = estimate(h) + 1;
+  for(size_t row=0;row<SKETCH_CMS_DEPTH;row++){
+    uint64_t& c = _counts[counter(row, h)];
+    c = std::max(c, count);
+  }
+  // Most values of a long column are no candidates and stop here
+  if(_capacity == 0 || (_candidates.size() == _capacity && count <= _candidates[0].count)) return;
+  offer(h, value, count);
+}
+
+void csv::Top_Values::merge(const Top_Values& o){
+  if(o._counts.size() != _counts.size() || o._k != _k)
+    throw runtime_error("Cannot merge sketches of different sizes");
+  for(size_t i=0;i<_counts.size();i++) _counts[i] += o._counts[i];
+  // Candidates of either sketch, estimated anew
+  vector<Candidate> candidates = _candidates;
+  for(const Candidate& c:o._candidates)
+    if(_positions.count(c.hash) == 0) candidates.push_back(c);
+  for(Candidate& c:candidates) c.count = estimate(c.hash);
+  sort(candidates.begin(), candidates.end(),
+       [](const Candidate& a, const Candidate& b){
+	 return a.count != b.count ? a.count > b.count : a.value < b.value;
+       });
+  if(candidates.size() > _capacity) candidates.resize(_capacity);
+  // Ascending counts are a heap
+  _candidates.assign(candidates.rbegin(), candidates.rend());
+  _positions.clear();
+  for(size_t i=0;i<_candidates.size();i++) _positions[_candidates[i].hash] = i;
+}
+
+vector<pair<string,uint64_t>> csv::Top_Values::top() const {
+  vector<pair<string,uint64_t>> r;
+  // Counts of candidates are only updated when they are added
+  for(const Candidate& c:_candidates) r.push_back({c.value, estimate(c.hash)});
+  sort(r.begin(), r.end(),
+       [](const pair<string,uint64_t>& a, const pair<string,uint64_t>& b){
+	 return a.second != b.second ? a.second > b.second : a.first < b.first;
+       });
+  if(r.size() > _k) r.resize(_k);
+  return r;
+}
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <csv/sort.hpp>
+#include <csv/number.hpp>
+#include <csv/parallel.hpp>
+#include <csv/spill.hpp>
+
+using namespace std;
+using namespace csv;
+
+csv::Sort_Run::Sort_Run(const vector<Sort_Key>& keys, bool reverse) :
+  _keys {keys}, _reverse {reverse}, _max_key_col {0}, _starts {0}
+{
+  for(const Sort_Key& key:keys) _max_key_col = std::max(_max_key_col, key.col);
+}
+
+void csv::Sort_Run::append(const Linescan& lscan){
+  if(_max_key_col >= lscan.n_fields()) throw runtime_error("Key field missing");
+  if(n_rows() >= UINT32_MAX) throw runtime_error("Too many rows to sort"); // LCOV_EXCL_LINE
+  const char* begin = lscan.begin();
+  for(const Sort_Key& key:_keys)
+    _fields.push_back(Key_Field {0, (uint32_t)(lscan.field(key.col) - begin),
+				 (uint32_t)lscan.field_size(key.col)});
+  string scratch;
+  string_view row = lscan.row(scratch);
+  _bytes.insert(_bytes.end(), row.begin(), row.end());
+  _starts.push_back(_bytes.size());
+}
+
+void csv::Sort_Run::sort(){
+  size_t n = n_rows();
+  size_t n_keys = _keys.size();
+  for(size_t row=0;row<n;row++){
+    for(size_t k=0;k<n_keys;k++){
+      string_view f = field(row, k);
+      uint64_t prefix = 0;
+      if(_keys[k].type == Sort_Type::NUMERIC){
+	double x;
+	if(parse_number(f, x)) prefix = number_bits(x);
+      } else {
+	prefix = byte_prefix(f);
+      }
+      _fields[row * n_keys + k].prefix = prefix;
+    }
+  }
+
+  _order.resize(n);
+  for(size_t row=0;row<n;row++){
+    if(n_keys == 0){
+      _order[row] = Entry {0, (uint32_t)row, true};
+      continue;
+    }
+    const Key_Field& f = _fields[row * n_keys];
+    bool exact = _keys[0].type == Sort_Type::NUMERIC ? f.prefix != 0 : f.size <= sizeof(f.prefix);
+    _order[row] = Entry {_reverse ? ~f.prefix : f.prefix, (uint32_t)row, exact};
+  }
+  // Rows whose first keys fit into their prefixes only compare further keys
+  std::sort(_order.begin(), _order.end(),
+	    [this](const Entry& a, const Entry& b){
+	      if(a.prefix != b.prefix) return a.prefix < b.prefix;
+	      int r = compare(a.row, *this, b.row, a.exact && b.exact ? 1 : 0);
+	      return r != 0 ? r < 0 : a.row < b.row;
+	    });
+}
+
+void csv::Sort_Run::clear(){
+  _bytes.clear();
+  _starts.resize(1);
+  _fields.clear();
+  _order.clear();
+}
+
+int csv::Sort_Run::compare(size_t row, const Sort_Run& other, size_t other_row, size_t k) const {
+  size_t n_keys = _keys.size();
+  for(;k<n_keys;k++){
+    const Key_Field& a = _fields[row * n_keys + k];
+    const Key_Field& b = other._fields[other_row * n_keys + k];
+    int r;
+    if(a.prefix != b.prefix){
+      r = a.prefix < b.prefix ? -1 : 1;
+    } else if(_keys[k].type == Sort_Type::NUMERIC){
+      // Equal numbers, or two fields that are no numbers
+      if(a.prefix != 0) continue;
+      r = field(row, k).compare(other.field(other_row, k));
+    } else {
+      // The prefixes cover the first bytes of both fields
+      size_t skip = std::min({sizeof(uint64_t), (size_t)a.size, (size_t)b.size});
+      r = field(row, k).substr(skip).compare(other.field(other_row, k).substr(skip));
+    }
+    if(r != 0) return _reverse ? -r : r;
+  }
+  return 0;
+}
+
+void csv::Sort_Run::write(FILE* out) const {
+  for(const Entry& e:_order){
+    string_view l = line(e.row);
+    fwrite(l.data(), sizeof(char), l.size(), out);
+  }
+}
+
+namespace {
+  /* Position in a sorted run. Runs are either held in memory or read back
+     from a temporary file one row at a time. */
+  class Run_Cursor {
+  private:
+    const Sort_Run* _run;
+    size_t _pos;
+    unique_ptr<Input_Buffer> _cbuf;
+    unique_ptr<Linescan> _lscan;
+    unique_ptr<Sort_Run> _row;
+
+    void read_row(){
+      _row->clear();
+      _pos = 0;
+      if(_cbuf->at_eof()) return;
+      _lscan->do_scan_forward(_cbuf->head(), _cbuf->read_size());
+      _row->append(*_lscan);
+      _row->sort();
+      _cbuf->advance_head(_lscan->length());
+    }
+
+  public:
+    explicit Run_Cursor(const Sort_Run& run) : _run {&run}, _pos {0} {};
+    // Takes over f
+    Run_Cursor(FILE* f, char delimiter, bool crnl, const vector<Sort_Key>& keys, bool reverse,
+	       size_t read_size, size_t buffer_size) :
+      _cbuf {make_unique<Circbuf>(f, read_size, buffer_size)},
+      _lscan {make_unique<Linescan>(delimiter, read_size)},
+      _row {make_unique<Sort_Run>(keys, reverse)}
+    {
+      _lscan->set_crnl(crnl);
+      _run = _row.get();
+      read_row();
+    }
+
+    bool done() const { return _pos >= _run->n_rows(); };
+    const Sort_Run& run() const { return *_run; };
+    size_t row() const { return _run->sorted(_pos); };
+    void advance(){
+      if(_cbuf) read_row();
+      else _pos++;
+    };
+  };
+}
+
+// Writes the rows of all cursors in sorted order; equal rows of earlier cursors come first
+static void merge_runs(vector<Run_Cursor>& cursors, FILE* out){
+  auto after = [&cursors](size_t a, size_t b){
+		 int r = cursors[a].run().compare(cursors[a].row(), cursors[b].run(), cursors[b].row());
+		 return r != 0 ? r > 0 : a > b;
+	       };
+  vector<size_t> heap;
+  for(size_t i=0;i<cursors.size();i++)
+    if(!cursors[i].done()) heap.push_back(i);
+  make_heap(heap.begin(), heap.end(), after);
+  while(!heap.empty()){
+    pop_heap(heap.begin(), heap.end(), after);
+    Run_Cursor& cursor = cursors[heap.back()];
+    string_view l = cursor.run().line(cursor.row());
+    fwrite(l.data(), sizeof(char), l.size(), out);
+    cursor.advance();
+    if(cursor.done()) heap.pop_back();
+    else push_heap(heap.begin(), heap.end(), after);
+  }
+}
+
+void csv::sort_rows(Input_Buffer& cbuf, char delimiter, bool crnl,
+		    const vector<Sort_Key>& keys, bool reverse,
+		    size_t max_memory, size_t threads, FILE* out){
+  size_t read_size = cbuf.read_size();
+  size_t n_workers = std::max(threads, (size_t)1);
+  auto for_each = [threads](size_t n, const function<void(size_t,size_t)>& work){
+		    if(threads <= 1) for(size_t i=0;i<n;i++) work(i, 0);
+		    else run_parallel(n, threads, work);
+		  };
+
+  /* Every worker sorts one run per batch. A run takes its share of the memory
+     budget or, without one, its share of a mapped file (or SORT_RUN_SIZE
+     bytes of a stream). */
+  Mmap_Buffer* mbuf = dynamic_cast<Mmap_Buffer*>(&cbuf);
+  size_t run_limit = SIZE_MAX;
+  if(max_memory > 0) run_limit = std::max(max_memory / n_workers, (size_t)1);
+  else if(n_workers > 1) run_limit = mbuf != nullptr ? mbuf->remaining() / n_workers + 1 : SORT_RUN_SIZE;
+  auto full = [&](const Sort_Run& run){
+		return (max_memory > 0 ? run.memory() : run.size()) >= run_limit;
+	      };
+
+  // The cursors take over the files, which are closed once merged
+  vector<FILE*> files;
+  auto merge_files = [&](size_t begin, size_t end, FILE* merged){
+		       size_t buffer_size = std::max(4 * read_size,
+						     max_memory / (end - begin) / read_size * read_size);
+		       vector<Run_Cursor> cursors;
+		       for(size_t i=begin;i<end;i++){
+			 FILE* f = files[i];
+			 files[i] = nullptr;
+			 cursors.emplace_back(f, delimiter, crnl, keys, reverse, read_size, buffer_size);
+		       }
+		       merge_runs(cursors, merged);
+		     };
+  /* Replaces the files [begin, end) by one merged file. Merging consecutive
+     runs keeps equal rows in input order. */
+  vector<size_t> levels;
+  auto merge_group = [&](size_t begin, size_t end){
+		       files.push_back(create_temp_file());
+		       FILE* merged = files.back();
+		       merge_files(begin, end, merged);
+		       rewind_temp_file(merged);
+		       files.pop_back();
+		       files.erase(files.begin() + begin + 1, files.begin() + end);
+		       files[begin] = merged;
+		       levels.erase(levels.begin() + begin + 1, levels.begin() + end);
+		       levels[begin]++;
+		     };
+
+  Linescan lscan(delimiter, read_size);
+  lscan.set_crnl(crnl);
+  vector<unique_ptr<Sort_Run>> runs;
+  vector<unique_ptr<Sort_Run>> batch;
+  try {
+    while(!cbuf.at_eof()){
+      size_t n = 0;
+      for(;n<n_workers && !cbuf.at_eof();n++){
+	if(n == batch.size()) batch.push_back(make_unique<Sort_Run>(keys, reverse));
+	Sort_Run& run = *batch[n];
+	run.clear();
+	while(!cbuf.at_eof() && !full(run)){
+	  lscan.do_scan_forward(cbuf.head(), read_size);
+	  if(lscan.length() > 1) run.append(lscan); // Line is not empty
+	  cbuf.advance_head(lscan.length());
+	}
+      }
+      for_each(n, [&](size_t i, size_t){ batch[i]->sort(); });
+
+      // Runs stay in memory unless they exceed the budget
+      if(max_memory == 0 || (files.empty() && cbuf.at_eof())){
+	for(size_t i=0;i<n;i++) runs.push_back(std::move(batch[i]));
+	batch.clear();
+	continue;
+      }
+      size_t first = files.size();
+      for(size_t i=0;i<n;i++){
+	files.push_back(create_temp_file());
+	levels.push_back(0);
+      }
+      for_each(n, [&](size_t i, size_t){
+		    batch[i]->write(files[first + i]);
+		    rewind_temp_file(files[first + i]);
+		  });
+      /* Every SORT_MERGE_FANIN files of one level are merged into one of the
+	 next, which bounds the open files and reads every row once per level */
+      while(files.size() >= SORT_MERGE_FANIN &&
+	    std::all_of(levels.end() - SORT_MERGE_FANIN, levels.end(),
+			[&](size_t level){ return level == levels.back(); }))
+	merge_group(files.size() - SORT_MERGE_FANIN, files.size());
+    }
+    batch.clear();
+
+    if(files.empty()){
+      vector<Run_Cursor> cursors;
+      for(const unique_ptr<Sort_Run>& run:runs) cursors.emplace_back(*run);
+      merge_runs(cursors, out);
+      return;
+    }
+    while(files.size() > SORT_MERGE_FANIN) merge_group(0, SORT_MERGE_FANIN);
+    merge_files(0, files.size(), out);
+  } catch(...) {
+    for(FILE* f:files)
+      if(f != nullptr) fclose(f);
+    throw;
+  }
+}
@@ -0,0 +1,32 @@
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <stdexcept>
+
+#include <csv/spill.hpp>
+
+using namespace std;
+using namespace csv;
+
+FILE* csv::create_temp_file(){
+  const char* dir = getenv("TMPDIR");
+  string path = string(dir != nullptr && dir[0] != '\0' ? dir : "/tmp") + "/tab.XXXXXX";
+  int fd = mkstemp(&path[0]);
+  if(fd < 0) throw runtime_error("Could not create temporary file " + path + ": " + strerror(errno));
+  unlink(path.c_str());
+  FILE* r = fdopen(fd, "w+");
+  if(r == nullptr) { // LCOV_EXCL_START
+    close(fd);
+    throw runtime_error(string("Could not open temporary file: ") + strerror(errno));
+  } // LCOV_EXCL_STOP
+  return r;
+}
+
+void csv::rewind_temp_file(FILE* f){
+  if(fflush(f) != 0 || ferror(f)) // LCOV_EXCL_LINE
+    throw runtime_error(string("Could not write temporary file: ") + strerror(errno)); // LCOV_EXCL_LINE
+  rewind(f);
+}
@@ -0,0 +1,161 @@
+#include <math.h>
+
+#include <stdexcept>
+
+#include <csv/stats.hpp>
+#include <csv/number.hpp>
+
+using namespace std;
+using namespace csv;
+
+string csv::str(Column_Type type){
+  switch(type){
+  case Column_Type::EMPTY: return "empty";
+  case Column_Type::INTEGER: return "integer";
+  case Column_Type::NUMBER: return "number";
+  case Column_Type::TEXT: return "text";
+  }
+  throw runtime_error("Unknown column type"); // LCOV_EXCL_LINE
+}
+
+csv::Column_Stats::Column_Stats(size_t n_columns, bool approx, size_t top) :
+  _count (n_columns, 0), _nulls (n_columns, 0),
+  _numbers (n_columns, 0), _integers (n_columns, 0),
+  _integer_sum (n_columns, 0), _sum (n_columns, 0), _min (n_columns, 0), _max (n_columns, 0),
+  _text_min (n_columns), _text_max (n_columns),
+  _text_min_prefix (n_columns, 0), _text_max_prefix (n_columns, 0),
+  _distinct (approx ? n_columns : 0), _top (approx ? n_columns : 0, Top_Values(top)) {}
+
+void csv::Column_Stats::add(const Linescan& lscan){
+  size_t n_columns = _count.size();
+  size_t n = std::min(lscan.n_fields(), n_columns);
+  for(size_t col=0;col<n;col++){
+    string_view f = lscan.field_view(col);
+    if(f.empty()){
+      _nulls[col]++;
+      continue;
+    }
+
+    // The prefixes decide most comparisons without touching the strings
+    uint64_t prefix = byte_prefix(f);
+    if(_count[col]++ == 0){
+      set_text_min(col, f, prefix);
+      set_text_max(col, f, prefix);
+    } else if(prefix <= _text_min_prefix[col] && (prefix < _text_min_prefix[col] || f < _text_min[col])){
+      set_text_min(col, f, prefix);
+    } else if(prefix >= _text_max_prefix[col] && (prefix > _text_max_prefix[col] || f > _text_max[col])){
+      set_text_max(col, f, prefix);
+    }
+    if(approx()){
+      uint64_t h = sketch_hash(f);
+      _distinct[col].add(h);
+      _top[col].add(f, h);
+    }
+
+    double x;
+    int64_t i;
+    if(parse_integer(f, i)){
+      _integers[col]++;
+      add_integer(_integer_sum[col], _sum[col], i);
+      x = i;
+    } else if(parse_number(f, x)){
+      _sum[col] += x;
+    } else {
+      continue;
+    }
+    x = without_negative_zero(x);
+    if(_numbers[col]++ == 0){
+      _min[col] = _max[col] = x;
+    } else {
+      _min[col] = std::min(_min[col], x);
+      _max[col] = std::max(_max[col], x);
+    }
+  }
+  for(size_t col=n;col<n_columns;col++) _nulls[col]++;
+}
+
+void csv::Column_Stats::merge(const Column_Stats& o){
+  if(o.n_columns() != n_columns() || o.approx() != approx())
+    throw runtime_error("Cannot merge profiles of different tables");
+  for(size_t col=0;col<n_columns();col++){
+    if(o._count[col] > 0){
+      if(_count[col] == 0 || o._text_min[col] < _text_min[col])
+	set_text_min(col, o._text_min[col], o._text_min_prefix[col]);
+      if(_count[col] == 0 || o._text_max[col] > _text_max[col])
+	set_text_max(col, o._text_max[col], o._text_max_prefix[col]);
+    }
+    if(o._numbers[col] > 0){
+      _min[col] = _numbers[col] == 0 ? o._min[col] : std::min(_min[col], o._min[col]);
+      _max[col] = _numbers[col] == 0 ? o._max[col] : std::max(_max[col], o._max[col]);
+    }
+    _count[col] += o._count[col];
+    _nulls[col] += o._nulls[col];
+    _numbers[col] += o._numbers[col];
+    _integers[col] += o._integers[col];
+    _sum[col] += o._sum[col];
+    add_integer(_integer_sum[col], _sum[col], o._integer_sum[col]);
+    if(approx()){
+      _distinct[col].merge(o._distinct[col]);
+      _top[col].merge(o._top[col]);
+    }
+  }
+}
+
+Column_Type csv::Column_Stats::type(size_t col) const {
+  if(_count[col] == 0) return Column_Type::EMPTY;
+  if(_integers[col] == _count[col]) return Column_Type::INTEGER;
+  if(_numbers[col] == _count[col]) return Column_Type::NUMBER;
+  return Column_Type::TEXT;
+}
+
+string csv::Column_Stats::min(size_t col) const {
+  switch(type(col)){
+  case Column_Type::EMPTY: return "";
+  case Column_Type::TEXT: return _text_min[col];
+  default: return format_number(_min[col]);
+  }
+}
+
+string csv::Column_Stats::max(size_t col) const {
+  switch(type(col)){
+  case Column_Type::EMPTY: return "";
+  case Column_Type::TEXT: return _text_max[col];
+  default: return format_number(_max[col]);
+  }
+}
+
+string csv::Column_Stats::mean(size_t col) const {
+  Column_Type t = type(col);
+  if(t != Column_Type::INTEGER && t != Column_Type::NUMBER) return "";
+  return format_number((_integer_sum[col] + _sum[col]) / _numbers[col]);
+}
+
+string csv::Column_Stats::distinct(size_t col) const {
+  return to_string(llround(_distinct[col].estimate()));
+}
+
+string csv::Column_Stats::top(size_t col) const {
+  string r;
+  for(const pair<string,uint64_t>& value:_top[col].top())
+    r += (r.empty() ? "" : ";") + value.first + ":" + to_string(value.second);
+  return r;
+}
+
+void csv::Column_Stats::print(const vector<string>& columns, char delimiter, FILE* out) const {
+  auto print_row = [&](const vector<string>& fields){
+		     for(size_t i=0;i<fields.size();i++){
+		       if(i > 0) putc(delimiter, out);
+		       fputs(fields[i].c_str(), out);
+		     }
+		     putc(NL, out);
+		   };
+  vector<string> header = {"column", "type", "count", "nulls", "min", "max", "mean"};
+  if(approx()) header.insert(header.end(), {"distinct", "top"});
+  print_row(header);
+  for(size_t col=0;col<n_columns();col++){
+    vector<string> fields = {columns[col], str(type(col)), to_string(_count[col]),
+			     to_string(_nulls[col]), min(col), max(col), mean(col)};
+    if(approx()) fields.insert(fields.end(), {distinct(col), top(col)});
+    print_row(fields);
+  }
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <csv/top.hpp>
+#include <csv/number.hpp>
+
+using namespace std;
+using namespace csv;
+
+csv::Top_Rows::Top_Rows(size_t n, size_t col, bool ascending) :
+  _n {n}, _col {col}, _ascending {ascending}
+{
+  if(n >= UINT32_MAX) throw runtime_error("Too many top rows"); // LCOV_EXCL_LINE
+}
+
+void csv::Top_Rows::offer(uint64_t bits, uint64_t position, string_view line){
+  Entry e {bits, position, 0};
+  // The root of the heap is the row that comes last in the output
+  auto cmp = [this](const Entry& a, const Entry& b){ return before(a, b); };
+  if(_heap.size() < _n){
+    e.slot = _rows.size();
+    _rows.emplace_back();
+  } else if(_n > 0 && before(e, _heap.front())){
+    pop_heap(_heap.begin(), _heap.end(), cmp);
+    e.slot = _heap.back().slot;
+    _heap.pop_back();
+  } else {
+    return;
+  }
+  _rows[e.slot].assign(line);
+  _heap.push_back(e);
+  push_heap(_heap.begin(), _heap.end(), cmp);
+}
+
+void csv::Top_Rows::add(const Linescan& lscan, uint64_t position){
+  double x;
+  if(_col >= lscan.n_fields() || !parse_number(lscan.field_view(_col), x)) return;
+  uint64_t bits = number_bits(x);
+  if(_heap.size() == _n && (_n == 0 || !before(Entry {bits, position, 0}, _heap.front()))) return;
+
+  string scratch;
+  offer(bits, position, lscan.row(scratch));
+}
+
+void csv::Top_Rows::merge(const Top_Rows& o){
+  if(o._col != _col || o._ascending != _ascending)
+    throw runtime_error("Cannot merge top rows of different columns or orders");
+  for(const Entry& e:o._heap) offer(e.bits, e.position, o._rows[e.slot]);
+}
+
+vector<string_view> csv::Top_Rows::rows() const {
+  vector<Entry> sorted = _heap;
+  sort(sorted.begin(), sorted.end(), [this](const Entry& a, const Entry& b){ return before(a, b); });
+  vector<string_view> r;
+  for(const Entry& e:sorted) r.push_back(_rows[e.slot]);
+  return r;
+}
+
+void csv::Top_Rows::write(FILE* out) const {
+  for(string_view line:rows()) fwrite(line.data(), sizeof(char), line.size(), out);
+}
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <stdexcept>
+
+#include <csv/uniq.hpp>
+#include <csv/join.hpp>
+#include <csv/spill.hpp>
+
+using namespace std;
+using namespace csv;
+
+// Slots of an empty set; always a power of two
+static const size_t INITIAL_SLOTS = 64;
+
+csv::Key_Set::Key_Set(bool exact) : _exact {exact} {
+  clear();
+}
+
+void csv::Key_Set::clear(){
+  _slots.assign(INITIAL_SLOTS, Slot {0, 0});
+  _hashes.clear();
+  _keys.clear();
+  _key_starts.assign(1, 0);
+}
+
+size_t csv::Key_Set::memory() const {
+  return _slots.size() * sizeof(Slot) + _hashes.size() * sizeof(uint64_t) +
+    _keys.size() + (_exact ? _key_starts.size() * sizeof(size_t) : 0);
+}
+
+void csv::Key_Set::grow(){
+  _slots.assign(2 * _slots.size(), Slot {0, 0});
+  size_t mask = _slots.size() - 1;
+  for(uint32_t i=0;i<size();i++){
+    size_t s = _hashes[i] & mask;
+    while(_slots[s].hash != 0) s = (s + 1) & mask;
+    _slots[s] = Slot {_hashes[i], i};
+  }
+}
+
+uint32_t csv::Key_Set::insert(uint64_t h, string_view k, bool& inserted){
+  size_t mask = _slots.size() - 1;
+  for(size_t s=h & mask;;s=(s + 1) & mask){
+    Slot& slot = _slots[s];
+    if(slot.hash == h && (!_exact || key(slot.key) == k)){
+      inserted = false;
+      return slot.key;
+    }
+    if(slot.hash != 0) continue;
+
+    if(size() >= UINT32_MAX) throw runtime_error("Too many keys"); // LCOV_EXCL_LINE
+    uint32_t i = size();
+    _hashes.push_back(h);
+    if(_exact){
+      _keys.insert(_keys.end(), k.begin(), k.end());
+      _key_starts.push_back(_keys.size());
+    }
+    slot = Slot {h, i};
+    if(2 * size() > _slots.size()) grow();
+    inserted = true;
+    return i;
+  }
+}
+
+namespace {
+  /* A row in a temporary file: the fingerprint and (for exact sets) the key
+     of its key fields, its input position, and the row itself. Rows without
+     bytes stand for keys whose first row has been written already. */
+  struct Spilled_Row {
+    uint64_t hash;
+    uint64_t position;
+    string key;
+    string line;
+  };
+
+  void write_row(FILE* f, uint64_t h, uint64_t position, string_view key, string_view line){
+    uint64_t header[4] = {h, position, key.size(), line.size()};
+    fwrite(header, sizeof(uint64_t), 4, f);
+    fwrite(key.data(), sizeof(char), key.size(), f);
+    fwrite(line.data(), sizeof(char), line.size(), f);
+  }
+
+  // False once f is exhausted
+  bool read_row(FILE* f, Spilled_Row& r){
+    uint64_t header[4];
+    size_t n = fread(header, sizeof(uint64_t), 4, f);
+    if(n == 0 && feof(f)) return false;
+    if(n == 4){
+      r.key.resize(header[2]);
+      r.line.resize(header[3]);
+    }
+    if(n != 4 || fread(&r.key[0], sizeof(char), r.key.size(), f) != r.key.size() ||
+       fread(&r.line[0], sizeof(char), r.line.size(), f) != r.line.size())
+      throw runtime_error("Could not read temporary file"); // LCOV_EXCL_LINE
+    r.hash = header[0];
+    r.position = header[1];
+    return true;
+  }
+
+  size_t partition(uint64_t h){
+    // The low bits select the slot in Key_Set
+    return (h >> 32) % UNIQ_PARTITIONS;
+  }
+}
+
+// Deduplicates a partition into survivors, in input order
+static void uniq_partition(FILE* f, bool exact, bool last, FILE* survivors){
+  Key_Set keys(exact);
+  Spilled_Row r;
+  bool inserted;
+  if(!last){
+    while(read_row(f, r)){
+      keys.insert(r.hash, r.key, inserted);
+      if(inserted && !r.line.empty()) write_row(survivors, 0, r.position, "", r.line);
+    }
+    return;
+  }
+
+  vector<Spilled_Row> kept;
+  while(read_row(f, r)){
+    uint32_t i = keys.insert(r.hash, r.key, inserted);
+    if(inserted) kept.push_back(move(r));
+    else kept[i] = move(r);
+  }
+  sort(kept.begin(), kept.end(),
+       [](const Spilled_Row& a, const Spilled_Row& b){ return a.position < b.position; });
+  for(const Spilled_Row& k:kept) write_row(survivors, 0, k.position, "", k.line);
+}
+
+// Writes the rows of all files, each in input order, in input order
+static void merge_partitions(const vector<FILE*>& files, FILE* out){
+  vector<Spilled_Row> heads(files.size());
+  vector<size_t> heap;
+  for(size_t i=0;i<files.size();i++)
+    if(read_row(files[i], heads[i])) heap.push_back(i);
+  auto after = [&heads](size_t a, size_t b){ return heads[a].position > heads[b].position; };
+  make_heap(heap.begin(), heap.end(), after);
+  while(!heap.empty()){
+    pop_heap(heap.begin(), heap.end(), after);
+    size_t i = heap.back();
+    fwrite(heads[i].line.data(), sizeof(char), heads[i].line.size(), out);
+    if(read_row(files[i], heads[i])) push_heap(heap.begin(), heap.end(), after);
+    else heap.pop_back();
+  }
+}
+
+void csv::uniq_rows(Input_Buffer& cbuf, char delimiter, bool crnl,
+		    const vector<size_t>& key_cols, bool exact, bool last,
+		    size_t max_memory, FILE* out){
+  if(key_cols.empty()) throw runtime_error("No key columns");
+  size_t read_size = cbuf.read_size();
+  Linescan lscan(delimiter, read_size);
+  lscan.set_crnl(crnl);
+  size_t max_key_col = *max_element(key_cols.begin(), key_cols.end());
+
+  Key_Set keys(exact);
+  // Only with last: the last row of every key so far, and its position
+  vector<string> last_lines;
+  vector<uint64_t> last_positions;
+  size_t last_bytes = 0;
+  auto memory = [&](){
+		  return keys.memory() + last_bytes +
+		    last_lines.size() * (sizeof(string) + sizeof(uint64_t));
+		};
+
+  // Once the keys outgrow max_memory: UNIQ_PARTITIONS partitions, then as many survivors
+  vector<FILE*> files;
+  auto spill = [&](){
+		 for(size_t p=0;p<UNIQ_PARTITIONS;p++) files.push_back(create_temp_file());
+		 for(size_t i=0;i<keys.size();i++){
+		   FILE* f = files[partition(keys.hash(i))];
+		   // First rows are written already, only their keys are left
+		   if(last) write_row(f, keys.hash(i), last_positions[i], keys.key(i), last_lines[i]);
+		   else write_row(f, keys.hash(i), 0, keys.key(i), "");
+		 }
+		 keys = Key_Set(exact);
+		 last_lines = vector<string>();
+		 last_positions = vector<uint64_t>();
+		 last_bytes = 0;
+	       };
+
+  try {
+    string key;
+    string line;
+    uint64_t position = 0;
+    while(!cbuf.at_eof()){
+      lscan.do_scan_forward(cbuf.head(), read_size);
+      size_t length = lscan.length();
+      if(length > 1){ // Line is not empty
+	if(max_key_col >= lscan.n_fields()) throw runtime_error("Key field missing");
+	uint64_t h = hash_key(key_cols.size(), [&](size_t k){ return lscan.field_view(key_cols[k]); });
+	if(exact){
+	  key.clear();
+	  for(size_t k=0;k<key_cols.size();k++){
+	    if(k > 0) key += delimiter;
+	    key += lscan.field_view(key_cols[k]);
+	  }
+	}
+	string_view l = lscan.row(line);
+
+	if(!files.empty()){
+	  write_row(files[partition(h)], h, position, key, l);
+	} else {
+	  bool inserted;
+	  uint32_t i = keys.insert(h, key, inserted);
+	  if(!last){
+	    if(inserted) fwrite(l.data(), sizeof(char), l.size(), out);
+	  } else if(inserted){
+	    last_lines.emplace_back(l);
+	    last_positions.push_back(position);
+	    last_bytes += l.size();
+	  } else {
+	    last_bytes = last_bytes - last_lines[i].size() + l.size();
+	    last_lines[i].assign(l);
+	    last_positions[i] = position;
+	  }
+	  if(max_memory > 0 && memory() > max_memory) spill();
+	}
+      }
+      position++;
+      cbuf.advance_head(length);
+    }
+
+    if(files.empty()){
+      if(!last) return;
+      vector<size_t> order(last_lines.size());
+      iota(order.begin(), order.end(), 0);
+      sort(order.begin(), order.end(),
+	   [&](size_t a, size_t b){ return last_positions[a] < last_positions[b]; });
+      for(size_t i:order) fwrite(last_lines[i].data(), sizeof(char), last_lines[i].size(), out);
+      return;
+    }
+
+    // All rows of a key are in the same partition
+    for(size_t p=0;p<UNIQ_PARTITIONS;p++){
+      rewind_temp_file(files[p]);
+      files.push_back(create_temp_file());
+      uniq_partition(files[p], exact, last, files.back());
+      rewind_temp_file(files.back());
+    }
+    merge_partitions(vector<FILE*>(files.begin() + UNIQ_PARTITIONS, files.end()), out);
+  } catch(...) {
+    for(FILE* f:files) fclose(f);
+    throw;
+  }
+  for(FILE* f:files) fclose(f);
+}
@@ -0,0 +1,92 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include <csv/classify.hpp>
+
+typedef std::vector<size_t> Vec_size_t;
+
+class Classify_Test : public CxxTest::TestSuite {
+private:
+  std::vector<csv::Simd_Level> levels = {csv::Simd_Level::SCALAR, csv::Simd_Level::SSE2,
+					 csv::Simd_Level::AVX2};
+
+  std::vector<csv::Simd_Level> supported_levels(){
+    std::vector<csv::Simd_Level> r;
+    for(csv::Simd_Level level:levels)
+      if(level <= csv::simd_level()) r.push_back(level);
+    return r;
+  }
+
+public:
+  void setUp(){
+  }
+
+  void tearDown(){
+  }
+
+  void test_find_fields(){
+    std::string s = "ab,c,,d\nx,y";
+    for(csv::Simd_Level level:supported_levels()){
+      Vec_size_t out;
+      TS_ASSERT_EQUALS(7,csv::find_fields(level, s.c_str(), s.size(), ',', out, 10));
+      TS_ASSERT_EQUALS((Vec_size_t{12,14,15}),out);
+
+      // No newline
+      out.clear();
+      TS_ASSERT_EQUALS(3,csv::find_fields(level, s.c_str() + 8, 3, ',', out, 0));
+      TS_ASSERT_EQUALS((Vec_size_t{1}),out);
+    }
+  }
+
+  void test_rfind_fields(){
+    std::string s = "x,y\nab,c,,d";
+    const char* end = s.c_str() + s.size();
+    for(csv::Simd_Level level:supported_levels()){
+      Vec_size_t out;
+      TS_ASSERT_EQUALS(8,csv::rfind_fields(level, end, s.size(), ',', out));
+      TS_ASSERT_EQUALS((Vec_size_t{2,3,5}),out);
+
+      // No newline
+      out.clear();
+      TS_ASSERT_EQUALS(0,csv::rfind_fields(level, s.c_str() + 3, 3, ',', out));
+      TS_ASSERT_EQUALS((Vec_size_t{2}),out);
+    }
+  }
+
+  void test_random(){
+    // Long lines cross several 64 byte blocks; all levels have to agree
+    std::mt19937 rng(42);
+    std::string alphabet = "abc,,\n";
+    for(size_t round=0;round<200;round++){
+      size_t size = 1 + rng() % 400;
+      std::string s;
+      for(size_t i=0;i<size;i++){
+	bool rare_newline = rng() % 8 != 0;
+	char c = alphabet[rng() % alphabet.size()];
+	s.push_back(c == '\n' && rare_newline ? 'a' : c);
+      }
+      size_t pos = rng() % size;
+      Vec_size_t ref_out, ref_rout;
+      size_t ref = csv::find_fields(csv::Simd_Level::SCALAR, s.c_str() + pos, size - pos, ',',
+				    ref_out, pos);
+      size_t rref = csv::rfind_fields(csv::Simd_Level::SCALAR, s.c_str() + pos, pos, ',',
+				      ref_rout);
+      for(csv::Simd_Level level:supported_levels()){
+	Vec_size_t out, rout;
+	TS_ASSERT_EQUALS(ref,csv::find_fields(level, s.c_str() + pos, size - pos, ',', out, pos));
+	TS_ASSERT_EQUALS(ref_out,out);
+	TS_ASSERT_EQUALS(rref,csv::rfind_fields(level, s.c_str() + pos, pos, ',', rout));
+	TS_ASSERT_EQUALS(ref_rout,rout);
+      }
+    }
+  }
+
+  void test_str(){
+    TS_ASSERT_EQUALS("scalar",csv::str(csv::Simd_Level::SCALAR));
+    TS_ASSERT_EQUALS("avx2",csv::str(csv::Simd_Level::AVX2));
+  }
+
+};
@@ -0,0 +1,128 @@
+#include <cxxtest/TestSuite.h>
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <csv/groupby.hpp>
+
+#include "helpers.hpp"
+
+class Group_Table_Test : public CxxTest::TestSuite {
+private:
+  csv::Group_Table create(){
+    return csv::Group_Table({0, 1},
+			    {{csv::Agg_Type::COUNT, 0}, {csv::Agg_Type::SUM, 2},
+			     {csv::Agg_Type::MIN, 2}, {csv::Agg_Type::MAX, 2},
+			     {csv::Agg_Type::MEAN, 2}},
+			    ',');
+  }
+
+  std::string printed(const csv::Group_Table& table){
+    return captured([&](FILE* out){ table.print(out); });
+  }
+
+  const std::vector<const char*> lines = {"a,x,1\n", "b,x,2.5\n", "a,x,-3\n", "a,,4\n",
+					  "b,x,n/a\n", "c,y\n", "a,x,7\n"};
+
+public:
+  void test_aggregates(){
+    csv::Group_Table table = create();
+    for(size_t i=0;i<lines.size();i++) add_line(table, lines[i], i);
+    TS_ASSERT_EQUALS(4, table.n_groups());
+    TS_ASSERT_EQUALS("a,x\n" "b,x\n" "a,\n" "c,y\n", std::string(table.key(0)) + "\n" +
+		     std::string(table.key(1)) + "\n" + std::string(table.key(2)) + "\n" +
+		     std::string(table.key(3)) + "\n");
+    TS_ASSERT_EQUALS("a,x,3,5,-3,7,1.6666666666666667\n"
+		     "b,x,2,2.5,2.5,2.5,2.5\n"
+		     "a,,1,4,4,4,4\n"
+		     // Groups without numbers have no sum, minimum, maximum or mean
+		     "c,y,1,,,,\n", printed(table));
+    TS_ASSERT_THROWS_ANYTHING(add_line(table, "a\n", 7));
+  }
+
+  void test_merge(){
+    csv::Group_Table all = create();
+    for(size_t i=0;i<lines.size();i++) add_line(all, lines[i], i);
+    for(size_t split=0;split<=lines.size();split++){
+      // The later rows go to the first table, which still prints the groups in input order
+      csv::Group_Table a = create(), b = create();
+      for(size_t i=0;i<lines.size();i++) add_line(i < split ? b : a, lines[i], i);
+      a.merge(b);
+      TS_ASSERT_EQUALS(printed(all), printed(a));
+    }
+    TS_ASSERT_THROWS_ANYTHING(all.merge(csv::Group_Table({0}, {}, ',')));
+  }
+
+  void test_spill(){
+    csv::Group_Table all = create();
+    for(size_t i=0;i<lines.size();i++) add_line(all, lines[i], i);
+
+    csv::Group_Spill spill(3);
+    csv::Group_Table table = create();
+    for(size_t i=0;i<lines.size();i++){
+      add_line(table, lines[i], i);
+      if(i % 2 == 1) spill.spill(table);
+    }
+    spill.spill(table);
+    TS_ASSERT(spill.spilled());
+    TS_ASSERT_EQUALS(0, table.n_groups());
+
+    // Every group is in a single partition
+    csv::Group_Table merged = create();
+    size_t n_groups = 0;
+    for(size_t p=0;p<spill.n_partitions();p++){
+      table.read(spill.partition(p));
+      n_groups += table.n_groups();
+      merged.merge(table);
+      table.clear();
+    }
+    TS_ASSERT_EQUALS(4, n_groups);
+    TS_ASSERT_EQUALS(printed(all), printed(merged));
+  }
+
+  void test_large_integers(){
+    // Beyond 2^53, doubles would lose the 1 or keep it, depending on the order of rows
+    const std::vector<const char*> large = {"k,x,9007199254740993\n", "k,x,-9007199254740992\n",
+					    "k,x,1\n", "k,x,0.5\n", "m,x,9223372036854775807\n",
+					    "m,x,1\n"};
+    for(size_t split=0;split<=large.size();split++){
+      csv::Group_Table a = create(), b = create();
+      for(size_t i=0;i<large.size();i++) add_line(i < split ? b : a, large[i], i);
+      a.merge(b);
+      // Integers that overflow the sum are added as doubles
+      TS_ASSERT_EQUALS("k,x,4,2.5,-9007199254740992,9007199254740992,0.625\n"
+		       "m,x,2,9223372036854775808,1,9223372036854775808,4611686018427387904\n",
+		       printed(a));
+    }
+    csv::Group_Table table = create();
+    add_line(table, "k,x,9007199254740993\n", 0);
+    add_line(table, "k,x,2\n", 1);
+    TS_ASSERT_EQUALS("9007199254740995", table.value(0, 1));
+  }
+
+  void test_agg_type(){
+    for(csv::Agg_Type type:{csv::Agg_Type::COUNT, csv::Agg_Type::SUM, csv::Agg_Type::MIN,
+			    csv::Agg_Type::MAX, csv::Agg_Type::MEAN})
+      TS_ASSERT_EQUALS(csv::str(type), csv::str(csv::agg_type(csv::str(type))));
+    TS_ASSERT_THROWS_ANYTHING(csv::agg_type("median"));
+  }
+
+  void test_signed_zero(){
+    // Tables merged in either order agree on the minimum and maximum of -0 and 0
+    csv::Group_Table a = create(), b = create();
+    add_line(a, "k,x,-0\n", 0);
+    add_line(a, "k,x,-0.0\n", 1);
+    add_line(b, "k,x,0\n", 2);
+    csv::Group_Table ab = create(), ba = create();
+    ab.merge(a);
+    ab.merge(b);
+    ba.merge(b);
+    ba.merge(a);
+    TS_ASSERT_EQUALS(printed(ab), printed(ba));
+    TS_ASSERT_EQUALS("k,x,3,0,0,0,0\n", printed(ab));
+    TS_ASSERT_EQUALS("0", a.value(0, 2));
+  }
+};
@@ -0,0 +1,52 @@
+#ifndef TEST_HELPERS_HPP_
+#define TEST_HELPERS_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include <csv/match.hpp>
+
+// A single line, which must end in a newline, scanned as a row of an input buffer
+class Scanned_Line {
+private:
+  std::string _buf;
+
+public:
+  csv::Linescan lscan;
+
+  Scanned_Line(const char* line, size_t read_size = 100, char delimiter = ',') :
+    _buf {std::string("\n") + line + std::string(read_size, '\0')},
+    lscan {delimiter, read_size}
+  {
+    lscan.do_scan_forward(_buf.data() + 1, read_size);
+  }
+};
+
+// Adds a line to a table that takes rows as scanned by a Linescan, e.g. stats or groups
+template<class Table, class... Args>
+void add_line(Table& table, const char* line, Args... args){
+  table.add(Scanned_Line(line).lscan, args...);
+}
+
+// Everything write writes to the FILE* it is given
+template<class Write>
+std::string captured(Write write){
+  char* bytes = nullptr;
+  size_t size = 0;
+  FILE* out = open_memstream(&bytes, &size);
+  try {
+    write(out);
+  } catch(...) {
+    fclose(out);
+    free(bytes);
+    throw;
+  }
+  fclose(out);
+  std::string r(bytes, size);
+  free(bytes);
+  return r;
+}
+
+#endif
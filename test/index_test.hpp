@@ -5,6 +5,7 @@
 #include <stdexcept>
 
 #include <stdio.h>
+#include <unistd.h>
 
 #include <csv/index.hpp>
 #include <csv/st.hpp>
@@ -16,9 +17,9 @@ typedef std::vector<std::string> Vec_string;
 class Index_Test : public CxxTest::TestSuite {
 private:
   size_t read_size = 100;
-  size_t buffer_size = 100 * 100;
   size_t offsets_size = 100;
   std::string in_path = "./test_resources/simple.csv";
+  std::string index_path = "./test_resources/simple.csv.test.tabidx";
   Vecs_size_t ref_offsetss = {{0,3,6,8},{0,2,4,6,7},
 		       {0,1}, {0,3,5,7},
 		       {0,3,7,11},{0,3,6,10,11},
@@ -31,10 +32,11 @@ private:
 
 public:
   void setUp(){
-    idx = csv::Index::create(in_path, delimiter, read_size, buffer_size, offsets_size);
+    idx = csv::Index::create(in_path, delimiter, read_size, offsets_size);
   }
 
   void tearDown(){
+    unlink(index_path.c_str());
   }
 
   void test_create(){
@@ -47,7 +49,103 @@ public:
 
     TS_ASSERT_EQUALS(ref_line_offsets.size(),line_offsets.size());
     TS_ASSERT_EQUALS(ref_line_offsets,line_offsets);
+    TS_ASSERT_EQUALS(8,idx->n_lines());
+    TS_ASSERT_EQUALS(4,idx->n_fields(5));
+    TS_ASSERT_EQUALS(0,idx->column_keys().at("a"));
   }
 
-};
+  void test_field(){
+    TS_ASSERT_EQUALS(std::string("2a"),std::string(idx->field(0,1),idx->field_size(0,1)));
+    TS_ASSERT_EQUALS(std::string("3"),std::string(idx->field(0,2),idx->field_size(0,2)));
+    TS_ASSERT_EQUALS(0,idx->field_size(2,0));
+    TS_ASSERT_EQUALS(0,idx->field_size(5,3));
+    TS_ASSERT_EQUALS(nullptr,idx->field(0,3));
+    TS_ASSERT_EQUALS(nullptr,idx->field(8,0));
+    TS_ASSERT_EQUALS(std::string("1a,2a,3\n"),std::string(idx->line(0),idx->line_size(0)));
+    TS_ASSERT_EQUALS(0,idx->line_size(8));
+  }
+
+  void test_save_load(){
+    idx->save(index_path);
+    std::unique_ptr<csv::Index> loaded = csv::Index::load(in_path, index_path, delimiter, read_size);
+    TS_ASSERT(loaded);
+    TS_ASSERT_EQUALS(ref_offsetss,loaded->offsetss());
+    TS_ASSERT_EQUALS(ref_line_offsets,loaded->line_offsets());
+    TS_ASSERT(idx->column_keys() == loaded->column_keys());
+    TS_ASSERT_EQUALS(std::string("2a"),std::string(loaded->field(0,1),loaded->field_size(0,1)));
+
+    // Another delimiter does not match the index
+    TS_ASSERT(!csv::Index::load(in_path, index_path, ';', read_size));
+  }
+
+  void test_sparse(){
+    std::unique_ptr<csv::Index> sparse =
+      csv::Index::create(in_path, delimiter, read_size, offsets_size, 3);
+    TS_ASSERT(sparse->sparse());
+    TS_ASSERT_EQUALS(8,sparse->n_lines());
+    TS_ASSERT_EQUALS(ref_line_offsets,sparse->line_offsets());
+    // Backward lookups restart at the closest anchor
+    TS_ASSERT_EQUALS(std::string("21"),std::string(sparse->field(7,2),sparse->field_size(7,2)));
+    TS_ASSERT_EQUALS(std::string("2a"),std::string(sparse->field(0,1),sparse->field_size(0,1)));
+    TS_ASSERT_EQUALS(nullptr,sparse->field(0,3));
+
+    sparse->save(index_path);
+    std::unique_ptr<csv::Index> loaded = csv::Index::load(in_path, index_path, delimiter, read_size);
+    TS_ASSERT(loaded->sparse());
+    TS_ASSERT_EQUALS(ref_offsetss,loaded->offsetss());
+    TS_ASSERT_EQUALS(ref_line_offsets,loaded->line_offsets());
+  }
+
+  void test_create_threads(){
+    std::unique_ptr<csv::Index> parallel =
+      csv::Index::create(in_path, delimiter, read_size, offsets_size, 0, 4);
+    TS_ASSERT_EQUALS(ref_offsetss,parallel->offsetss());
+    TS_ASSERT_EQUALS(ref_line_offsets,parallel->line_offsets());
+  }
+
+  void test_load_missing(){
+    TS_ASSERT(!csv::Index::load(in_path, index_path, delimiter, read_size));
+  }
 
+  void test_load_stale(){
+    std::string csv_path = "./test_resources/simple.test.csv";
+    std::string path = csv::Index::sidecar_path(csv_path);
+    FILE* f = fopen(csv_path.c_str(),"w");
+    fputs("a,b\n1,2\n",f);
+    fclose(f);
+    csv::Index::create(csv_path, delimiter, read_size, offsets_size)->save(path);
+    TS_ASSERT_EQUALS(1,csv::Index::load(csv_path, path, delimiter, read_size)->n_lines());
+
+    f = fopen(csv_path.c_str(),"a");
+    fputs("3,4\n",f);
+    fclose(f);
+    TS_ASSERT(!csv::Index::load(csv_path, path, delimiter, read_size));
+    csv::Index::create(csv_path, delimiter, read_size, offsets_size)->save(path);
+    TS_ASSERT_EQUALS(2,csv::Index::load(csv_path, path, delimiter, read_size)->n_lines());
+    unlink(path.c_str());
+    unlink(csv_path.c_str());
+  }
+
+  void test_parse_row_range(){
+    size_t begin, end;
+    csv::parse_row_range("2:5", begin, end);
+    TS_ASSERT_EQUALS(2, begin);
+    TS_ASSERT_EQUALS(5, end);
+    csv::parse_row_range(":3", begin, end);
+    TS_ASSERT_EQUALS(0, begin);
+    TS_ASSERT_EQUALS(3, end);
+    csv::parse_row_range("4:", begin, end);
+    TS_ASSERT_EQUALS(4, begin);
+    TS_ASSERT_EQUALS(SIZE_MAX, end);
+    csv::parse_row_range("7", begin, end);
+    TS_ASSERT_EQUALS(7, begin);
+    TS_ASSERT_EQUALS(8, end);
+    csv::parse_row_range(":", begin, end);
+    TS_ASSERT_EQUALS(0, begin);
+    TS_ASSERT_EQUALS(SIZE_MAX, end);
+
+    for(const char* range:{"2:-1", "-1:3", "-1", "1x:2y", "1:2y", "x", "+1:2", " 1:2", "5:2",
+			   "99999999999999999999:"})
+      TS_ASSERT_THROWS_ANYTHING(csv::parse_row_range(range, begin, end));
+  }
+};
@@ -0,0 +1,423 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+
+#include <csv/join.hpp>
+
+#include "helpers.hpp"
+
+class Join_Table_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 100;
+  std::unique_ptr<csv::Csv> csv;
+
+  std::vector<uint32_t> matches(const csv::Join_Table& table, const char* line,
+				const std::vector<size_t>& key_cols){
+    std::vector<uint32_t> r;
+    for(uint32_t i=table.find(Scanned_Line(line, read_size).lscan, key_cols);i!=csv::Join_Table::NONE;i=table.next(i))
+      r.push_back(i);
+    return r;
+  }
+
+public:
+  void setUp(){
+    csv = csv::Csv::create(csv::Mmap_Buffer::create("./test_resources/simple.4.csv", read_size), ',');
+  }
+
+  void test_find(){
+    csv::Join_Table table(*csv, {0});
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({2}), matches(table, "1a,x\n", {0}));
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({}), matches(table, "1b,x\n", {0}));
+    // Empty lines are not part of the table
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({}), matches(table, "\n", {0}));
+  }
+
+  void test_find_duplicates(){
+    csv::Join_Table table(*csv, {2});
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({2,5}), matches(table, "x,5\n", {1}));
+  }
+
+  void test_find_multi_column(){
+    csv::Join_Table table(*csv, {2,3});
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({5}), matches(table, "5,4\n", {0,1}));
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({}), matches(table, "5,c4\n", {0,1}));
+    TS_ASSERT_THROWS_ANYTHING(matches(table, "5\n", {0,1}));
+  }
+
+  void test_missing_key_column(){
+    TS_ASSERT_THROWS_ANYTHING(csv::Join_Table(*csv, {4}));
+    TS_ASSERT_THROWS_ANYTHING(csv::Join_Table(*csv, {4}, 3));
+  }
+
+  void test_threads(){
+    // Enough rows for several partitions, with 1000 distinct keys
+    size_t n_rows = 5 * csv::JOIN_PARTITION_ROWS / 1000 * 1000;
+    std::string path = "./test_resources/join.test.csv";
+    FILE* f = fopen(path.c_str(), "w");
+    fputs("k,v\n", f);
+    for(size_t i=0;i<n_rows;i++)
+      fprintf(f, "%zu,%zu\n", i % 1000, i);
+    fclose(f);
+    std::unique_ptr<csv::Csv> big = csv::Csv::create(csv::Mmap_Buffer::create(path, read_size), ',', 3);
+    remove(path.c_str());
+
+    csv::Join_Table table_1(*big, {0});
+    csv::Join_Table table_3(*big, {0}, 3);
+    for(const char* line:{"0,x\n", "17,x\n", "999,x\n"}){
+      std::vector<uint32_t> r = matches(table_1, line, {0});
+      TS_ASSERT_EQUALS(n_rows / 1000, r.size());
+      TS_ASSERT(std::is_sorted(r.begin(), r.end()));
+      TS_ASSERT_EQUALS(r, matches(table_3, line, {0}));
+    }
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({}), matches(table_3, "1000,x\n", {0}));
+
+    // The Bloom filter must not lose any key
+    csv::Join_Table table_bloom(*big, {0}, 3, true);
+    for(size_t k=0;k<1000;k++)
+      TS_ASSERT_EQUALS(n_rows / 1000, matches(table_bloom, (std::to_string(k) + ",x\n").c_str(), {0}).size());
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({}), matches(table_bloom, "1000,x\n", {0}));
+  }
+
+  void test_read_keys(){
+    auto cbuf = csv::Mmap_Buffer::create("./test_resources/simple.4.csv", read_size);
+    std::unique_ptr<csv::Csv> keys = csv::read_keys(*cbuf, ',', {"e","a"});
+    TS_ASSERT_EQUALS(std::vector<std::string>({"e","a"}), keys->columns());
+    // The empty line is dropped
+    TS_ASSERT_EQUALS(8, keys->n_rows());
+    TS_ASSERT_EQUALS(2, keys->row(0).size());
+    TS_ASSERT_EQUALS("b", keys->row(0)[0]);
+    TS_ASSERT_EQUALS("7a", keys->row(0)[1]);
+    TS_ASSERT_EQUALS("1", keys->row(7)[0]);
+    TS_ASSERT_EQUALS("21", keys->row(7)[1]);
+
+    csv::Join_Table table(*keys, {1,0});
+    TS_ASSERT_EQUALS(std::vector<uint32_t>({1}), matches(table, "1a,c\n", {0,1}));
+
+    cbuf = csv::Mmap_Buffer::create("./test_resources/simple.4.csv", read_size);
+    TS_ASSERT_THROWS_ANYTHING(csv::read_keys(*cbuf, ',', {"f"}));
+  }
+
+  void test_payloads(){
+    csv::Join_Payloads payloads(*csv, {3,1}, ';');
+    TS_ASSERT_EQUALS(";b;8", payloads.row(1));
+    TS_ASSERT_EQUALS(";c;2b", payloads.row(2));
+    TS_ASSERT_EQUALS(";1;3", payloads.row(8));
+    // The empty line lacks the fields
+    TS_ASSERT_THROWS_ANYTHING(payloads.row(0));
+
+    csv::Join_Payloads payloads_3(*csv, {3,1}, ';', 3);
+    for(size_t i=1;i<csv->n_rows();i++)
+      TS_ASSERT_EQUALS(payloads.row(i), payloads_3.row(i));
+    TS_ASSERT_EQUALS("", csv::Join_Payloads(*csv, {}, ';').row(0));
+  }
+
+  void test_bloom_filter(){
+    csv::Bloom_Filter bloom(4);
+    TS_ASSERT(!bloom.contains(1, 12345));
+    bloom.add(1, 12345);
+    TS_ASSERT(bloom.contains(1, 12345));
+    TS_ASSERT(!bloom.contains(2, 12345));
+    size_t hits = 0;
+    for(uint32_t key=0;key<1000;key++)
+      if(bloom.contains(1, key * 2654435761U)) hits++;
+    TS_ASSERT_LESS_THAN(hits, 10);
+  }
+};
+
+class Join_Partition_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 100;
+
+  std::string read_all(FILE* f){
+    std::string r;
+    char buf[256];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0) r.append(buf, n);
+    fclose(f);
+    return r;
+  }
+
+public:
+  void test_join_partitions(){
+    csv::Table_Size size {1000, 10, 20};
+    size_t memory = csv::join_memory(size);
+    TS_ASSERT_EQUALS(1000 + 10 * csv::JOIN_ROW_MEMORY + 20 * csv::JOIN_FIELD_MEMORY
+		     + 1000 + 10 * csv::JOIN_PAYLOAD_ROW_MEMORY, memory);
+    // Semi and anti joins only keep the keys
+    size_t keys_memory = csv::join_memory(size, false);
+    TS_ASSERT_EQUALS(memory - 1000 - 10 * csv::JOIN_PAYLOAD_ROW_MEMORY, keys_memory);
+    TS_ASSERT_EQUALS(1,csv::join_partitions(size, keys_memory, false));
+    TS_ASSERT_LESS_THAN(1,csv::join_partitions(size, keys_memory));
+    TS_ASSERT_EQUALS(1,csv::join_partitions(size, 0));
+    TS_ASSERT_EQUALS(1,csv::join_partitions(size, memory));
+    TS_ASSERT_EQUALS(4,csv::join_partitions(size, memory / 2));
+    TS_ASSERT_EQUALS(csv::JOIN_MAX_PARTITIONS,csv::join_partitions(size, 1));
+    TS_ASSERT_EQUALS(csv::JOIN_STREAM_PARTITIONS,
+		     csv::join_partitions(csv::Table_Size {SIZE_MAX, SIZE_MAX, SIZE_MAX}, 1000));
+  }
+
+  void test_sample_table_size(){
+    // Files within the sample are counted exactly
+    csv::Table_Size size = csv::sample_table_size("./test_resources/simple.4.csv", 90, ',', read_size);
+    TS_ASSERT_EQUALS(82, size.bytes);
+    TS_ASSERT_EQUALS(9, size.rows);
+    TS_ASSERT_EQUALS(34, size.fields);
+    TS_ASSERT_EQUALS(7, csv::sample_table_size("./test_resources/simple.4.csv", 90, ',', read_size, 7).rows);
+    TS_ASSERT_EQUALS(SIZE_MAX, csv::sample_table_size("", SIZE_MAX, ',', read_size).rows);
+  }
+
+  void test_narrow_table_partitioned(){
+    // Rows of 10 bytes, in a file of several samples
+    size_t n_rows = 3 * csv::JOIN_SAMPLE_SIZE / 10;
+    std::string path = "./test_resources/join.test.csv";
+    FILE* f = fopen(path.c_str(), "w");
+    fputs("k,v\n", f);
+    for(size_t i=0;i<n_rows;i++)
+      fprintf(f, "%07zu,%zu\n", i, i % 10);
+    fclose(f);
+    size_t file_size = 4 + 10 * n_rows;
+    csv::Table_Size size = csv::sample_table_size(path, file_size, ',', read_size);
+    remove(path.c_str());
+    TS_ASSERT_EQUALS(10 * n_rows, size.bytes);
+    TS_ASSERT_DELTA((double)n_rows, (double)size.rows, 1);
+    TS_ASSERT_DELTA(2.0 * n_rows, (double)size.fields, 2);
+
+    // The table takes many times the size of the file
+    TS_ASSERT_LESS_THAN(1, csv::join_partitions(size, 4 * file_size));
+    TS_ASSERT_EQUALS(1, csv::join_partitions(size, csv::join_memory(size)));
+  }
+
+  void test_partition_rows(){
+    auto cbuf = csv::Mmap_Buffer::create("./test_resources/simple.4.csv", read_size);
+    std::vector<FILE*> files = csv::partition_rows(*cbuf, ',', {"d"}, 3);
+    TS_ASSERT_EQUALS(3,files.size());
+
+    size_t n_rows = 0;
+    std::vector<std::string> with_5;
+    for(FILE* f:files){
+      std::string content = read_all(f);
+      TS_ASSERT_EQUALS(0,content.find("a,b,d,e\n"));
+      for(size_t i=0;i<content.size();i++) if(content[i] == '\n') n_rows++;
+      if(content.find("1a,2b,5,c\n") != std::string::npos) with_5.push_back(content);
+    }
+    // 3 headers and all rows but the empty one
+    TS_ASSERT_EQUALS(3 + 8,n_rows);
+    // Equal keys share a partition
+    TS_ASSERT_EQUALS(1,with_5.size());
+    TS_ASSERT_DIFFERS(std::string::npos,with_5[0].find("19,20b,5,4\n"));
+  }
+
+  void test_partition_rows_missing_column(){
+    auto cbuf = csv::Mmap_Buffer::create("./test_resources/simple.4.csv", read_size);
+    TS_ASSERT_THROWS_ANYTHING(csv::partition_rows(*cbuf, ',', {"x"}, 3));
+  }
+};
+
+class Star_Join_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 100;
+  std::string path_1 = "./test_resources/join_1.test.csv";
+  std::string path_k = "./test_resources/join_k.test.csv";
+  std::string path_g = "./test_resources/join_g.test.csv";
+
+  void write(const std::string& path, const std::string& content){
+    FILE* f = fopen(path.c_str(), "w");
+    fputs(content.c_str(), f);
+    fclose(f);
+  }
+
+  // Output of joining the file at path_1 with the files paths_2
+  std::string join(csv::Join_Mode join_mode, const std::vector<std::string>& paths_2,
+		   const std::vector<std::vector<std::string>>& key_columns, size_t threads = 1){
+    auto cbuf_1 = csv::Mmap_Buffer::create(path_1, read_size);
+    std::vector<std::unique_ptr<csv::Input_Buffer>> cbufs_2;
+    for(const std::string& path_2:paths_2) cbufs_2.push_back(csv::Mmap_Buffer::create(path_2, read_size));
+    return captured([&](FILE* out){
+		      csv::join_buffers(join_mode, path_1, *cbuf_1, std::move(cbufs_2), ',', ',',
+					key_columns, read_size, true, threads, out);
+		    });
+  }
+
+public:
+  void setUp(){
+    write(path_1, "k,g,v\n" "1,a,x\n" "2,b,y\n" "3,a,z\n\n" "4,c,w\n" "5,a,u\n");
+    write(path_k, "k,p\n" "1,p1\n" "3,p3\n" "1,p2\n" "4,p4\n");
+    write(path_g, "g,q\n" "a,q1\n" "c,q3\n" "a,q2\n");
+  }
+
+  void tearDown(){
+    remove(path_1.c_str());
+    remove(path_k.c_str());
+    remove(path_g.c_str());
+  }
+
+  void test_parse_key_lists(){
+    typedef std::vector<std::vector<std::string>> Key_Lists;
+    TS_ASSERT_EQUALS(Key_Lists({{"k"}}), csv::parse_key_lists("k", 1));
+    TS_ASSERT_EQUALS(Key_Lists({{"k","g"}, {"k","g"}}), csv::parse_key_lists("k,g", 2));
+    TS_ASSERT_EQUALS(Key_Lists({{"k","g"}, {"g"}}), csv::parse_key_lists("k,g:g", 2));
+    TS_ASSERT_THROWS_ANYTHING(csv::parse_key_lists("k:g", 3));
+    TS_ASSERT_THROWS_ANYTHING(csv::parse_key_lists("k:g:v", 2));
+  }
+
+  void test_fan_out(){
+    // Every combination of matches, in the order of csv_1 and the tables, the last table changing fastest
+    std::string r = "k,g,v,p,q\n"
+      "1,a,x,p1,q1\n" "1,a,x,p1,q2\n" "1,a,x,p2,q1\n" "1,a,x,p2,q2\n"
+      "3,a,z,p3,q1\n" "3,a,z,p3,q2\n" "4,c,w,p4,q3\n";
+    TS_ASSERT_EQUALS(r, join(csv::Join_Mode::NATURAL, {path_k, path_g}, {{"k"}, {"g"}}));
+    TS_ASSERT_EQUALS(r, join(csv::Join_Mode::NATURAL, {path_k, path_g}, {{"k"}, {"g"}}, 3));
+    // A single table is the same join
+    TS_ASSERT_EQUALS("k,g,v,q\n" "1,a,x,q1\n" "1,a,x,q2\n" "3,a,z,q1\n" "3,a,z,q2\n"
+		     "4,c,w,q3\n" "5,a,u,q1\n" "5,a,u,q2\n",
+		     join(csv::Join_Mode::NATURAL, {path_g}, {{"g"}}));
+  }
+
+  void test_key_lists(){
+    // Each table is matched with its own key columns; a key missing from a table fails
+    TS_ASSERT_EQUALS("k,g,v,q,p\n" "1,a,x,q1,p1\n" "1,a,x,q1,p2\n" "1,a,x,q2,p1\n" "1,a,x,q2,p2\n"
+		     "3,a,z,q1,p3\n" "3,a,z,q2,p3\n" "4,c,w,q3,p4\n",
+		     join(csv::Join_Mode::NATURAL, {path_g, path_k}, {{"g"}, {"k"}}));
+    TS_ASSERT_THROWS_ANYTHING(join(csv::Join_Mode::NATURAL, {path_k, path_g}, {{"k"}, {"k"}}));
+    TS_ASSERT_THROWS_ANYTHING(join(csv::Join_Mode::NATURAL, {path_k, path_g}, {{"k"}}));
+  }
+
+  void test_left(){
+    // Tables without a match leave their columns empty
+    std::string r = "k,g,v,p,q\n"
+      "1,a,x,p1,q1\n" "1,a,x,p1,q2\n" "1,a,x,p2,q1\n" "1,a,x,p2,q2\n"
+      "2,b,y,,\n"
+      "3,a,z,p3,q1\n" "3,a,z,p3,q2\n" "4,c,w,p4,q3\n"
+      "5,a,u,,q1\n" "5,a,u,,q2\n";
+    TS_ASSERT_EQUALS(r, join(csv::Join_Mode::LEFT, {path_k, path_g}, {{"k"}, {"g"}}));
+    TS_ASSERT_EQUALS(r, join(csv::Join_Mode::LEFT, {path_k, path_g}, {{"k"}, {"g"}}, 3));
+  }
+
+  void test_semi_anti(){
+    // Semi: rows with a match in every table; anti: rows without a match in any
+    TS_ASSERT_EQUALS("k,g,v\n" "1,a,x\n" "3,a,z\n" "4,c,w\n",
+		     join(csv::Join_Mode::SEMI, {path_k, path_g}, {{"k"}, {"g"}}));
+    TS_ASSERT_EQUALS("k,g,v\n" "2,b,y\n",
+		     join(csv::Join_Mode::ANTI, {path_k, path_g}, {{"k"}, {"g"}}));
+    TS_ASSERT_EQUALS("k,g,v\n" "1,a,x\n" "3,a,z\n" "4,c,w\n" "5,a,u\n",
+		     join(csv::Join_Mode::SEMI, {path_g}, {{"g"}}));
+  }
+
+  void test_several_tables_unsupported(){
+    for(csv::Join_Mode join_mode:{csv::Join_Mode::RIGHT, csv::Join_Mode::FULL}){
+      TS_ASSERT_THROWS_ANYTHING(csv::check_join_tables(join_mode, 2, false, 0));
+      TS_ASSERT_THROWS_NOTHING(csv::check_join_tables(join_mode, 1, false, 0));
+      TS_ASSERT_THROWS_ANYTHING(join(join_mode, {path_k, path_g}, {{"k"}, {"g"}}));
+    }
+    for(csv::Join_Mode join_mode:{csv::Join_Mode::NATURAL, csv::Join_Mode::LEFT,
+				  csv::Join_Mode::SEMI, csv::Join_Mode::ANTI}){
+      TS_ASSERT_THROWS_NOTHING(csv::check_join_tables(join_mode, 2, false, 0));
+      // Sorted inputs and memory budgets only work on a single table
+      TS_ASSERT_THROWS_ANYTHING(csv::check_join_tables(join_mode, 2, true, 0));
+      TS_ASSERT_THROWS_ANYTHING(csv::check_join_tables(join_mode, 2, false, 1));
+      TS_ASSERT_THROWS_NOTHING(csv::check_join_tables(join_mode, 1, true, 0));
+      TS_ASSERT_THROWS_NOTHING(csv::check_join_tables(join_mode, 1, false, 1));
+    }
+  }
+};
+
+class Swapped_Join_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 100;
+  std::string path_1 = "./test_resources/swap_1.test.csv";
+  std::string path_2 = "./test_resources/swap_2.test.csv";
+
+  void write(const std::string& path, const std::string& content){
+    FILE* f = fopen(path.c_str(), "w");
+    fputs(content.c_str(), f);
+    fclose(f);
+  }
+
+  std::string join(csv::Join_Mode join_mode, bool swapped, size_t threads){
+    auto cbuf_1 = csv::Mmap_Buffer::create(path_1, read_size);
+    auto cbuf_2 = csv::Mmap_Buffer::create(path_2, read_size);
+    return captured([&](FILE* out){
+		      if(swapped){
+			csv::join_buffers_swapped(join_mode, std::move(cbuf_1), path_2, *cbuf_2, ',', ',',
+						  {"k"}, read_size, true, threads, out);
+		      } else {
+			std::vector<std::unique_ptr<csv::Input_Buffer>> cbufs_2;
+			cbufs_2.push_back(std::move(cbuf_2));
+			csv::join_buffers(join_mode, path_1, *cbuf_1, std::move(cbufs_2), ',', ',',
+					  {{"k"}}, read_size, true, threads, out);
+		      }
+		    });
+  }
+
+  // Header, then the other lines in sorted order
+  std::vector<std::string> multiset(const std::string& output){
+    std::vector<std::string> lines;
+    size_t begin = 0;
+    for(size_t end=output.find('\n');end!=std::string::npos;end=output.find('\n', begin)){
+      lines.push_back(output.substr(begin, end - begin));
+      begin = end + 1;
+    }
+    if(!lines.empty()) std::sort(lines.begin() + 1, lines.end());
+    return lines;
+  }
+
+public:
+  void setUp(){
+    // Duplicate and unmatched keys on both sides, and a shared column besides the key
+    write(path_1, "k,v,a\n" "1,x,a1\n" "2,y,a2\n" "2,z,a3\n" "5,w,a4\n\n");
+    write(path_2, "k,v,b\n" "2,p,b1\n" "2,q,b2\n" "3,r,b3\n" "1,s,b4\n");
+  }
+
+  void tearDown(){
+    remove(path_1.c_str());
+    remove(path_2.c_str());
+  }
+
+  void test_same_rows(){
+    for(csv::Join_Mode join_mode:{csv::Join_Mode::NATURAL, csv::Join_Mode::LEFT,
+				  csv::Join_Mode::RIGHT, csv::Join_Mode::FULL}){
+      std::vector<std::string> r = multiset(join(join_mode, false, 1));
+      TS_ASSERT_EQUALS(r, multiset(join(join_mode, true, 1)));
+      TS_ASSERT_EQUALS(r, multiset(join(join_mode, true, 3)));
+    }
+    TS_ASSERT_EQUALS(std::vector<std::string>({"k,v,a,b", "1,x,a1,b4", "2,y,a2,b1", "2,y,a2,b2",
+					       "2,z,a3,b1", "2,z,a3,b2", "3,r,,b3", "5,w,a4,"}),
+		     multiset(join(csv::Join_Mode::FULL, true, 1)));
+  }
+
+  void test_semi_anti_never_swap(){
+    csv::Table_Size small {10, 1, 2}, large {1000, 100, 200};
+    for(csv::Join_Mode join_mode:{csv::Join_Mode::SEMI, csv::Join_Mode::ANTI}){
+      TS_ASSERT(!csv::swap_join_sides(join_mode, csv::Build_Side::AUTO, 1, 1000, small, large));
+      TS_ASSERT_THROWS_ANYTHING(csv::swap_join_sides(join_mode, csv::Build_Side::CSV_1, 1, 0,
+						     small, large));
+      TS_ASSERT_THROWS_ANYTHING(join(join_mode, true, 1));
+    }
+  }
+
+  void test_swap_join_sides(){
+    csv::Join_Mode natural = csv::Join_Mode::NATURAL;
+    csv::Build_Side automatic = csv::Build_Side::AUTO;
+    csv::Table_Size unknown {SIZE_MAX, SIZE_MAX, SIZE_MAX};
+    csv::Table_Size small {10, 1, 2}, large {1000, 100, 200}, narrow {100, 50, 100}, wide {120, 2, 40};
+    // Only under a memory budget, for the smaller table by rows and fields as well as bytes
+    TS_ASSERT(csv::swap_join_sides(natural, automatic, 1, 1000, small, large));
+    TS_ASSERT(!csv::swap_join_sides(natural, automatic, 1, 1000, large, small));
+    TS_ASSERT(!csv::swap_join_sides(natural, automatic, 1, 0, small, large));
+    TS_ASSERT(csv::swap_join_sides(natural, automatic, 1, 1000, wide, narrow));
+    // Streams and several tables are never swapped
+    TS_ASSERT(!csv::swap_join_sides(natural, automatic, 1, 1000, unknown, large));
+    TS_ASSERT(!csv::swap_join_sides(natural, automatic, 1, 1000, small, unknown));
+    TS_ASSERT(!csv::swap_join_sides(natural, automatic, 2, 1000, small, large));
+    TS_ASSERT_THROWS_ANYTHING(csv::swap_join_sides(natural, csv::Build_Side::CSV_1, 2, 0,
+						   small, large));
+    // Unless forced
+    TS_ASSERT(csv::swap_join_sides(natural, csv::Build_Side::CSV_1, 1, 0, large, small));
+    TS_ASSERT(csv::swap_join_sides(natural, csv::Build_Side::CSV_1, 1, 0, unknown, unknown));
+    TS_ASSERT(!csv::swap_join_sides(natural, csv::Build_Side::CSV_2, 1, 1000, small, large));
+  }
+};
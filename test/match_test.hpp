@@ -8,6 +8,8 @@
 
 #include <csv/match.hpp>
 
+#include "helpers.hpp"
+
 typedef std::vector<size_t> Vec_size_t;
 typedef std::vector<std::string> Vec_string;
 
@@ -63,6 +65,85 @@ public:
 
 };
 
+class Mmap_Buffer_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 4;
+  std::string in_path = "./test_resources/bytes.txt";
+  std::unique_ptr<csv::Mmap_Buffer> mbuf;
+
+public:
+  void setUp(){
+    mbuf = csv::Mmap_Buffer::create(in_path, read_size);
+  }
+
+  void tearDown(){
+    mbuf.reset();
+  }
+
+  void test_advance_head(){
+    char* head = mbuf->head();
+    TS_ASSERT_EQUALS('a',head[0]);
+    TS_ASSERT_EQUALS('\n',head[-1]);
+    TS_ASSERT_EQUALS(true,mbuf->finished());
+    TS_ASSERT_EQUALS(read_size,mbuf->read_size());
+    TS_ASSERT_EQUALS(false,mbuf->at_eof());
+
+    head = mbuf->advance_head(4);
+    TS_ASSERT_EQUALS('e',head[0]);
+
+    for(size_t i=0;i<5;i++)
+      head = mbuf->advance_head(4);
+    // Close to the end now
+    TS_ASSERT_EQUALS('\n',head[2]);
+    TS_ASSERT_EQUALS('\0',head[3]);
+    TS_ASSERT_EQUALS(false,mbuf->at_eof());
+
+    head = mbuf->advance_head(4); // After EOF, every byte should be \0
+    TS_ASSERT_EQUALS(true,mbuf->at_eof());
+    for(size_t i=0;i<read_size;i++)
+      TS_ASSERT_EQUALS('\0',head[i]);
+
+    // Head does not move past the end of the data
+    TS_ASSERT_EQUALS(head,mbuf->advance_head(100));
+  }
+
+  void test_no_trailing_newline(){
+    mbuf = csv::Mmap_Buffer::create("./test_resources/simple.4.csv", 12);
+    csv::Linescan lscan(',', 12);
+    lscan.do_scan_header(mbuf->head(), mbuf->read_size());
+    mbuf->advance_head(lscan.length());
+    size_t lines = 0;
+    while(!mbuf->at_eof()){
+      lscan.do_scan(mbuf->head(), mbuf->read_size());
+      mbuf->advance_head(lscan.length());
+      lines++;
+    }
+    TS_ASSERT_EQUALS(9,lines);
+    TS_ASSERT_EQUALS("21,3,4,1",std::string(lscan.begin(),lscan.length()-1));
+  }
+
+  void test_create_range(){
+    // "4,5,6,\n\n7a,8,9\n" of simple.csv; following bytes read as \0
+    mbuf = csv::Mmap_Buffer::create("./test_resources/simple.csv", 12, 14, 15);
+    char* head = mbuf->head();
+    TS_ASSERT_EQUALS('\n',head[-1]);
+    TS_ASSERT_EQUALS("4,5,6,\n\n7a,8,9\n",std::string(head,15));
+    for(size_t i=15;i<15+12;i++)
+      TS_ASSERT_EQUALS('\0',head[i]);
+    TS_ASSERT_EQUALS(14,mbuf->position());
+    TS_ASSERT_EQUALS(15,mbuf->remaining());
+
+    mbuf->advance_head(7);
+    TS_ASSERT_EQUALS(21,mbuf->position());
+    TS_ASSERT_EQUALS(8,mbuf->remaining());
+  }
+
+  void test_create_missing_file(){
+    TS_ASSERT_THROWS_ANYTHING(csv::Mmap_Buffer::create("./test_resources/missing.csv", read_size));
+  }
+
+};
+
 class Regex_Matcher_Test : public CxxTest::TestSuite {
 private:
   std::string s = "abcd";
@@ -268,6 +349,48 @@ public:
     }
   }
 
+  void test_do_scan_forward(){
+
+    auto offsets = Vec_size_t{0,1,5,9,13,15};
+
+    { // Normal operation
+      lscan->reset();
+      lscan->do_scan_forward(b+1,size-1);
+      TS_ASSERT_EQUALS(offsets,lscan->offsets());
+      TS_ASSERT_EQUALS(b+1,lscan->begin());
+      TS_ASSERT_EQUALS(size-1,lscan->length());
+      TS_ASSERT_EQUALS(0,lscan->match_field());
+      TS_ASSERT_EQUALS(5,lscan->n_fields());
+      auto fields = Vec_string{"","cda","cda","cda","c"};
+      for(size_t i=0;i<lscan->n_fields();i++){
+	TS_ASSERT_EQUALS(fields[i],lscan->field_str(i));
+      }
+    }
+
+    { // Same result as scanning in both directions
+      csv::Linescan both(delimiter,size);
+      both.do_scan(b+1,size-1);
+      lscan->reset();
+      lscan->do_scan_forward(b+1,size-1);
+      TS_ASSERT_EQUALS(both.offsets(),lscan->offsets());
+      TS_ASSERT_EQUALS(both.length(),lscan->length());
+    }
+
+    { // Null terminator works as alternative newline
+      b[size-1] = '\0';
+      lscan->reset();
+      lscan->do_scan_forward(b+1,size-1);
+      TS_ASSERT_EQUALS(offsets,lscan->offsets());
+      TS_ASSERT_EQUALS('\n',b[size-1]);
+    }
+
+    { // No right newline
+      b[size-1] = 'x';
+      lscan->reset();
+      TS_ASSERT_THROWS_ANYTHING(lscan->do_scan_forward(b+1,size-1));
+    }
+  }
+
   void test_do_scan_header(){
 
     auto offsets = Vec_size_t{0,1,5,9,13,15};
@@ -337,6 +460,31 @@ public:
     }
   }
 
+  void test_row(){
+    std::string scratch;
+    lscan->reset();
+    lscan->do_scan_forward(b+1,size-1);
+    std::string_view row = lscan->row(scratch);
+    TS_ASSERT_EQUALS(b+1,row.data());
+    TS_ASSERT_EQUALS(size-1,row.size());
+
+    { // A last line without newline gets one in CRNL mode
+      lscan->set_crnl(true);
+      row = lscan->row(scratch);
+      TS_ASSERT_EQUALS(scratch.data(),row.data());
+      TS_ASSERT_EQUALS(std::string(b+1,size-2) + "\r\n",std::string(row));
+    }
+
+    { // Rows that end in CRNL are left as they are
+      b[size-2] = '\r';
+      lscan->reset();
+      lscan->do_scan_forward(b+1,size-1);
+      row = lscan->row(scratch);
+      TS_ASSERT_EQUALS(b+1,row.data());
+      TS_ASSERT_EQUALS(size-1,row.size());
+    }
+  }
+
   void test_str(){
     std::string s = lscan->str();
     TS_ASSERT(!s.empty());
@@ -599,3 +747,64 @@ public:
     TS_ASSERT_EQUALS('\0',cbuf->head()[0]);
   }
 };
+
+class Csv_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 100;
+
+public:
+  void test_create(){
+    std::unique_ptr<csv::Csv> csv =
+      csv::Csv::create(csv::Mmap_Buffer::create("./test_resources/simple.csv", read_size), ',');
+    TS_ASSERT_EQUALS(Vec_string({"a","b","c"}),csv->columns());
+    TS_ASSERT_EQUALS(8,csv->n_rows());
+
+    csv::Csv_Row row = csv->row(0);
+    TS_ASSERT_EQUALS(3,row.size());
+    TS_ASSERT_EQUALS("1a",row[0]);
+    TS_ASSERT_EQUALS("3",row[2]);
+
+    // Empty line
+    TS_ASSERT_EQUALS(1,csv->row(2).size());
+    TS_ASSERT_EQUALS("",csv->row(2)[0]);
+
+    row = csv->row(7);
+    TS_ASSERT_EQUALS(3,row.size());
+    TS_ASSERT_EQUALS("21",row[2]);
+  }
+
+  void test_create_threads(){
+    for(const char* path:{"./test_resources/simple.csv", "./test_resources/simple.4.csv"}){
+      std::unique_ptr<csv::Csv> csv_1 = csv::Csv::create(csv::Mmap_Buffer::create(path, read_size), ',');
+      std::unique_ptr<csv::Csv> csv_3 = csv::Csv::create(csv::Mmap_Buffer::create(path, read_size), ',', 3);
+      TS_ASSERT_EQUALS(csv_1->columns(),csv_3->columns());
+      TS_ASSERT_EQUALS(csv_1->n_rows(),csv_3->n_rows());
+      for(size_t i=0;i<csv_1->n_rows();i++){
+	TS_ASSERT_EQUALS(csv_1->row(i).size(),csv_3->row(i).size());
+	for(size_t j=0;j<csv_1->row(i).size();j++)
+	  TS_ASSERT_EQUALS(csv_1->row(i)[j],csv_3->row(i)[j]);
+      }
+    }
+  }
+
+  void test_append(){
+    csv::Csv csv(Vec_string({"a","b"}));
+    // Lines padded to read_size, as the scan reads whole blocks
+    Scanned_Line line_2("1,,3\n", read_size);
+    csv.append(Scanned_Line("xy,z\n", read_size).lscan);
+    csv.append(line_2.lscan);
+    TS_ASSERT_EQUALS(Vec_string({"a","b"}),csv.columns());
+    TS_ASSERT_EQUALS(2,csv.n_rows());
+    TS_ASSERT_EQUALS("xy",csv.row(0)[0]);
+    TS_ASSERT_EQUALS("z",csv.row(0)[1]);
+    TS_ASSERT_EQUALS(3,csv.row(1).size());
+    TS_ASSERT_EQUALS("",csv.row(1)[1]);
+    TS_ASSERT_EQUALS("3",csv.row(1)[2]);
+
+    csv.clear();
+    TS_ASSERT_EQUALS(0,csv.n_rows());
+    csv.append(line_2.lscan);
+    TS_ASSERT_EQUALS(1,csv.n_rows());
+    TS_ASSERT_EQUALS("1",csv.row(0)[0]);
+  }
+};
@@ -0,0 +1,67 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <stdio.h>
+
+#include <csv/parallel.hpp>
+
+#include "helpers.hpp"
+
+typedef std::vector<size_t> Vec_size_t;
+
+class Parallel_Test : public CxxTest::TestSuite {
+private:
+  std::string s = "ab\ncd\n\nefgh\ni";
+
+public:
+  void setUp(){
+  }
+
+  void tearDown(){
+  }
+
+  void test_split_lines(){
+    TS_ASSERT_EQUALS((Vec_size_t{0,13}), csv::split_lines(s.c_str(), s.size(), 1));
+    TS_ASSERT_EQUALS((Vec_size_t{0,7,13}), csv::split_lines(s.c_str(), s.size(), 2));
+    TS_ASSERT_EQUALS((Vec_size_t{0,6,12,13}), csv::split_lines(s.c_str(), s.size(), 3));
+    // More chunks than lines
+    TS_ASSERT_EQUALS((Vec_size_t{0,3,6,7,12,13}), csv::split_lines(s.c_str(), s.size(), 100));
+    TS_ASSERT_EQUALS((Vec_size_t{0,0}), csv::split_lines(s.c_str(), 0, 4));
+  }
+
+  void test_chunk_count(){
+    TS_ASSERT_EQUALS(4 * csv::PARALLEL_CHUNKS_PER_THREAD, csv::chunk_count(100, 4));
+    TS_ASSERT_EQUALS(11, csv::chunk_count(10 * csv::PARALLEL_CHUNK_SIZE, 1));
+  }
+
+  void test_run_ordered(){
+    std::string r = captured([](FILE* out){
+			       csv::run_ordered(50, 4, [](size_t chunk, size_t, FILE* chunk_out){
+							 fprintf(chunk_out, "%lu;", chunk);
+						       }, out);
+			     });
+    std::string ref;
+    for(size_t i=0;i<50;i++) ref += std::to_string(i) + ";";
+    TS_ASSERT_EQUALS(ref, r);
+  }
+
+  void test_run_ordered_error(){
+    TS_ASSERT_THROWS_ANYTHING(csv::run_ordered(10, 3, [](size_t chunk, size_t, FILE*){
+							  if(chunk == 5) throw std::runtime_error("chunk");
+							}, stdout));
+  }
+
+  void test_run_parallel(){
+    std::vector<size_t> done(100, 0);
+    csv::run_parallel(done.size(), 4, [&done](size_t chunk, size_t){ done[chunk]++; });
+    TS_ASSERT_EQUALS(std::vector<size_t>(100, 1), done);
+
+    TS_ASSERT_THROWS_ANYTHING(csv::run_parallel(10, 3, [](size_t chunk, size_t){
+							    if(chunk == 5) throw std::runtime_error("chunk");
+							  }));
+  }
+
+};
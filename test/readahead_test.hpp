@@ -0,0 +1,95 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <stdexcept>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <csv/readahead.hpp>
+
+class Readahead_Buffer_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 4;
+  size_t buffer_size = 16;
+  std::string in_path = "./test_resources/bytes.txt";
+  csv::Readahead_Buffer* rbuf;
+
+public:
+  void setUp(){
+    rbuf = new csv::Readahead_Buffer(in_path, read_size, buffer_size);
+  }
+
+  void tearDown(){
+    delete rbuf;
+  }
+
+  void test_advance_head(){
+    char* head = rbuf->head();
+    TS_ASSERT_EQUALS('a',head[0]);
+    TS_ASSERT_EQUALS('\n',head[-1]);
+    TS_ASSERT_EQUALS(false,rbuf->finished());
+    TS_ASSERT_EQUALS(read_size,rbuf->read_size());
+    TS_ASSERT_EQUALS(false,rbuf->at_eof());
+
+    head = rbuf->advance_head(4);
+    TS_ASSERT_EQUALS('e',head[0]);
+    TS_ASSERT_EQUALS("abcd",std::string(head-4,4)); // Bytes left of head stay available
+
+    for(size_t i=0;i<5;i++)
+      head = rbuf->advance_head(4);
+    // Close to the end now
+    TS_ASSERT_EQUALS('\n',head[2]);
+    TS_ASSERT_EQUALS('\0',head[3]);
+    TS_ASSERT_EQUALS(true,rbuf->finished()); // Reached EOF
+    TS_ASSERT_EQUALS(false,rbuf->at_eof()); // Head not yet at EOF
+
+    head = rbuf->advance_head(4); // After EOF, every byte should be \0
+    TS_ASSERT_EQUALS(true,rbuf->at_eof());
+    for(size_t i=0;i<4;i++)
+      TS_ASSERT_EQUALS('\0',head[i]);
+  }
+
+  void test_lines(){
+    // Many more blocks than fit into the ring
+    csv::Readahead_Buffer r("./test_resources/simple.csv", 12, 12);
+    csv::Linescan lscan(',', 12);
+    lscan.do_scan_header(r.head(), r.read_size());
+    r.advance_head(lscan.length());
+    std::vector<std::string> lines;
+    while(!r.at_eof()){
+      lscan.do_scan(r.head(), r.read_size());
+      lines.push_back(std::string(lscan.begin(), lscan.length()-1));
+      r.advance_head(lscan.length());
+    }
+    auto ref = std::vector<std::string>{"1a,2a,3","4,5,6,","","7a,8,9","10,11a,12a",
+					"13,14,15a,","16,17,18,","19,20b,21"};
+    TS_ASSERT_EQUALS(ref,lines);
+  }
+
+  void test_constructor_fd(){
+    FILE* fd = fopen(in_path.c_str(),"r");
+    csv::Readahead_Buffer r(fd,read_size,buffer_size);
+    char* head = r.advance_head(4);
+    TS_ASSERT_EQUALS('e',head[0]);
+  }
+
+  void test_destroy_while_waiting(){
+    // The writer keeps the pipe open, so the reader waits for more input
+    int fds[2];
+    TS_ASSERT_EQUALS(0, pipe(fds));
+    std::string bytes(2 * read_size, 'a');
+    TS_ASSERT_EQUALS((ssize_t)bytes.size(), write(fds[1], bytes.data(), bytes.size()));
+    {
+      csv::Readahead_Buffer r(fdopen(fds[0], "r"), read_size, buffer_size);
+      TS_ASSERT_EQUALS('a', r.head()[0]);
+    }
+    close(fds[1]);
+  }
+
+  void test_missing_file(){
+    TS_ASSERT_THROWS_ANYTHING(csv::Readahead_Buffer("./test_resources/missing.csv",
+						    read_size, buffer_size));
+  }
+
+};
@@ -0,0 +1,93 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+#include <csv/sketch.hpp>
+
+class Sketch_Test : public CxxTest::TestSuite {
+public:
+  void test_hyper_log_log(){
+    csv::Hyper_Log_Log empty;
+    TS_ASSERT_EQUALS(0, empty.estimate());
+
+    csv::Hyper_Log_Log all, a, b;
+    for(size_t i=0;i<100000;i++){
+      // Every value twice
+      uint64_t h = csv::sketch_hash(std::to_string(i % 50000));
+      all.add(h);
+      (i % 3 == 0 ? a : b).add(h);
+    }
+    TS_ASSERT_DELTA(50000, all.estimate(), 50000 * 0.05);
+    a.merge(b);
+    TS_ASSERT_EQUALS(all.estimate(), a.estimate());
+
+    csv::Hyper_Log_Log small;
+    for(size_t i=0;i<100;i++) small.add(csv::sketch_hash(std::to_string(i % 10)));
+    TS_ASSERT_DELTA(10, small.estimate(), 0.5);
+    TS_ASSERT_THROWS_ANYTHING(small.merge(csv::Hyper_Log_Log(4)));
+  }
+
+  void test_top_values(){
+    csv::Top_Values all(2), a(2), b(2);
+    // Two heavy values among many rare ones
+    for(size_t i=0;i<20000;i++){
+      std::string value = i % 4 == 0 ? "x" : i % 4 == 1 ? "y" : std::to_string(i);
+      if(i % 8 == 1) value = std::to_string(i);
+      all.add(value, csv::sketch_hash(value));
+      csv::Top_Values& part = i < 7000 ? a : b;
+      part.add(value, csv::sketch_hash(value));
+    }
+    std::vector<std::pair<std::string,uint64_t>> top = all.top();
+    TS_ASSERT_EQUALS(2, top.size());
+    TS_ASSERT_EQUALS("x", top[0].first);
+    TS_ASSERT_LESS_THAN_EQUALS(5000, top[0].second);
+    TS_ASSERT_EQUALS("y", top[1].first);
+    TS_ASSERT_LESS_THAN_EQUALS(2500, top[1].second);
+
+    a.merge(b);
+    std::vector<std::pair<std::string,uint64_t>> merged = a.top();
+    TS_ASSERT_EQUALS(2, merged.size());
+    TS_ASSERT_EQUALS("x", merged[0].first);
+    TS_ASSERT_EQUALS("y", merged[1].first);
+    TS_ASSERT_THROWS_ANYTHING(a.merge(csv::Top_Values(3)));
+  }
+
+  void test_top_values_replaced(){
+    // Value i occurs 600 / i times, interleaved, so candidates keep being updated and replaced
+    csv::Top_Values top(3, 1 << 16);
+    for(size_t r=0;r<600;r++)
+      for(size_t i=1;i<=200;i++)
+	if(r % i == 0){
+	  std::string value = std::to_string(i);
+	  top.add(value, csv::sketch_hash(value));
+	}
+    std::vector<std::pair<std::string,uint64_t>> ref = {{"1",600},{"2",300},{"3",200}};
+    TS_ASSERT(ref == top.top());
+  }
+
+  void test_top_values_merge_parts(){
+    // "t" leads overall, but every part has three values that are more frequent there
+    csv::Top_Values all(3);
+    std::vector<csv::Top_Values> parts(4, csv::Top_Values(3));
+    for(size_t p=0;p<parts.size();p++){
+      std::vector<std::string> values;
+      for(size_t r=0;r<30;r++){
+	if(r < 25) values.push_back("t");
+	for(size_t j=0;j<3;j++) values.push_back("p" + std::to_string(p) + "_" + std::to_string(j));
+	for(size_t j=0;j<3;j++) values.push_back("r" + std::to_string(p * 1000 + r * 3 + j));
+      }
+      for(const std::string& value:values){
+	all.add(value, csv::sketch_hash(value));
+	parts[p].add(value, csv::sketch_hash(value));
+      }
+    }
+    TS_ASSERT_EQUALS("t", all.top()[0].first);
+    TS_ASSERT_EQUALS(100, all.top()[0].second);
+    for(size_t p=1;p<parts.size();p++) parts[0].merge(parts[p]);
+    TS_ASSERT(all.top() == parts[0].top());
+    TS_ASSERT_EQUALS("t", parts[0].top()[0].first);
+  }
+};
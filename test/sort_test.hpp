@@ -0,0 +1,101 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include <stdio.h>
+
+#include <csv/sort.hpp>
+#include <csv/number.hpp>
+
+#include "helpers.hpp"
+
+class Sort_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 100;
+  std::string path = "./test_resources/simple.4.csv";
+
+  // Sorts the rows of the file at csv_path that follow its header
+  std::string sort(const std::string& csv_path, const std::vector<csv::Sort_Key>& keys,
+		   bool reverse = false, size_t max_memory = 0, size_t threads = 1){
+    auto cbuf = csv::Mmap_Buffer::create(csv_path, read_size);
+    csv::Linescan lscan(',', read_size);
+    lscan.do_scan_header(cbuf->head(), read_size);
+    cbuf->advance_head(lscan.length());
+    return captured([&](FILE* out){
+		      csv::sort_rows(*cbuf, ',', lscan.crnl(), keys, reverse, max_memory, threads, out);
+		    });
+  }
+
+public:
+  void test_sort_lexical(){
+    std::string r = "10,11a,18,3\n13,14,3,aa\n21,3,4,1\n1a,2b,5,c\n19,20b,5,4\n"
+      "4,5,6,4,7\n16,17,9,1\n7a,8,a,b\n";
+    TS_ASSERT_EQUALS(r, sort(path, {{2, csv::Sort_Type::LEXICAL}}));
+    // Runs spilled to temporary files give the same order
+    TS_ASSERT_EQUALS(r, sort(path, {{2, csv::Sort_Type::LEXICAL}}, false, 1));
+    TS_ASSERT_EQUALS(r, sort(path, {{2, csv::Sort_Type::LEXICAL}}, false, 0, 3));
+  }
+
+  void test_sort_numeric(){
+    // Fields that are no numbers come first
+    std::string r = "7a,8,a,b\n13,14,3,aa\n21,3,4,1\n1a,2b,5,c\n19,20b,5,4\n"
+      "4,5,6,4,7\n16,17,9,1\n10,11a,18,3\n";
+    TS_ASSERT_EQUALS(r, sort(path, {{2, csv::Sort_Type::NUMERIC}}));
+    TS_ASSERT_EQUALS(r, sort(path, {{2, csv::Sort_Type::NUMERIC}}, false, 1, 2));
+  }
+
+  void test_sort_reverse(){
+    // Equal keys keep their order
+    std::string r = "10,11a,18,3\n16,17,9,1\n4,5,6,4,7\n1a,2b,5,c\n19,20b,5,4\n"
+      "21,3,4,1\n13,14,3,aa\n7a,8,a,b\n";
+    TS_ASSERT_EQUALS(r, sort(path, {{2, csv::Sort_Type::NUMERIC}}, true));
+    TS_ASSERT_EQUALS(r, sort(path, {{2, csv::Sort_Type::NUMERIC}}, true, 1));
+  }
+
+  void test_sort_multi_column(){
+    std::string r = "21,3,4,1\n16,17,9,1\n10,11a,18,3\n19,20b,5,4\n4,5,6,4,7\n"
+      "13,14,3,aa\n7a,8,a,b\n1a,2b,5,c\n";
+    TS_ASSERT_EQUALS(r, sort(path, {{3, csv::Sort_Type::LEXICAL}, {2, csv::Sort_Type::NUMERIC}}));
+  }
+
+  void test_sort_merge_passes(){
+    // More runs than are merged at once
+    std::string csv_path = "./test_resources/sort.test.csv";
+    FILE* f = fopen(csv_path.c_str(), "w");
+    fputs("k,v\n", f);
+    size_t n_rows = 3 * csv::SORT_MERGE_FANIN * csv::SORT_MERGE_FANIN;
+    for(size_t i=0;i<n_rows;i++)
+      fprintf(f, "%zu,%zu\n", (i * 7919) % 1000, i);
+    fclose(f);
+    std::vector<csv::Sort_Key> keys = {{0, csv::Sort_Type::NUMERIC}};
+    std::string r = sort(csv_path, keys);
+    TS_ASSERT_EQUALS(r, sort(csv_path, keys, false, 256, 2));
+    remove(csv_path.c_str());
+    TS_ASSERT_EQUALS(0, r.find("0,0\n0,1000\n0,2000\n"));
+  }
+
+  void test_sort_missing_key_field(){
+    TS_ASSERT_THROWS_ANYTHING(sort(path, {{4, csv::Sort_Type::LEXICAL}}));
+    TS_ASSERT_THROWS_ANYTHING(sort(path, {{4, csv::Sort_Type::LEXICAL}}, false, 1));
+  }
+
+  void test_parse_number(){
+    double x;
+    TS_ASSERT(csv::parse_number("-1.5e2", x));
+    TS_ASSERT_EQUALS(-150, x);
+    TS_ASSERT(csv::parse_number("+3", x));
+    TS_ASSERT_EQUALS(3, x);
+    TS_ASSERT(!csv::parse_number("", x));
+    TS_ASSERT(!csv::parse_number("3a", x));
+    TS_ASSERT(!csv::parse_number("+-3", x));
+    TS_ASSERT(!csv::parse_number("nan", x));
+    TS_ASSERT_LESS_THAN(0, csv::number_bits(-1e300));
+    TS_ASSERT_LESS_THAN(csv::number_bits(-2), csv::number_bits(-1));
+    TS_ASSERT_LESS_THAN(csv::number_bits(-1), csv::number_bits(0));
+    TS_ASSERT_EQUALS(csv::number_bits(-0.0), csv::number_bits(0.0));
+    TS_ASSERT_LESS_THAN(csv::number_bits(0.5), csv::number_bits(2));
+  }
+};
@@ -0,0 +1,102 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <csv/stats.hpp>
+
+#include "helpers.hpp"
+
+class Column_Stats_Test : public CxxTest::TestSuite {
+public:
+  void test_types(){
+    csv::Column_Stats stats(5);
+    add_line(stats, "1,1.5,x,,7\n");
+    add_line(stats, "-20,3,5,,\n");
+    add_line(stats, "+3,1e2,ab\n");
+    TS_ASSERT_EQUALS("integer", csv::str(stats.type(0)));
+    TS_ASSERT_EQUALS("number", csv::str(stats.type(1)));
+    TS_ASSERT_EQUALS("text", csv::str(stats.type(2)));
+    TS_ASSERT_EQUALS("empty", csv::str(stats.type(3)));
+    TS_ASSERT_EQUALS("integer", csv::str(stats.type(4)));
+  }
+
+  void test_values(){
+    csv::Column_Stats stats(3);
+    add_line(stats, "1,b,\n");
+    add_line(stats, "-20,abc\n");
+    add_line(stats, "4,5\n");
+    TS_ASSERT_EQUALS(3, stats.count(0));
+    TS_ASSERT_EQUALS(0, stats.nulls(0));
+    TS_ASSERT_EQUALS("-20", stats.min(0));
+    TS_ASSERT_EQUALS("4", stats.max(0));
+    TS_ASSERT_EQUALS("-5", stats.mean(0));
+    // Text columns compare as bytes, numbers included
+    TS_ASSERT_EQUALS("5", stats.min(1));
+    TS_ASSERT_EQUALS("b", stats.max(1));
+    TS_ASSERT_EQUALS("", stats.mean(1));
+    // Missing fields are nulls
+    TS_ASSERT_EQUALS(0, stats.count(2));
+    TS_ASSERT_EQUALS(3, stats.nulls(2));
+    TS_ASSERT_EQUALS("", stats.min(2));
+  }
+
+  void test_merge(){
+    std::vector<const char*> lines = {"3,b,1\n", "x,a,2.5\n", ",c,\n", "7,aa,-1\n", "2,bb,4\n"};
+    csv::Column_Stats all(3);
+    for(const char* line:lines) add_line(all, line);
+    for(size_t split=0;split<=lines.size();split++){
+      csv::Column_Stats a(3), b(3);
+      for(size_t i=0;i<lines.size();i++) add_line(i < split ? a : b, lines[i]);
+      a.merge(b);
+      for(size_t col=0;col<3;col++){
+	TS_ASSERT_EQUALS(csv::str(all.type(col)), csv::str(a.type(col)));
+	TS_ASSERT_EQUALS(all.count(col), a.count(col));
+	TS_ASSERT_EQUALS(all.nulls(col), a.nulls(col));
+	TS_ASSERT_EQUALS(all.min(col), a.min(col));
+	TS_ASSERT_EQUALS(all.max(col), a.max(col));
+	TS_ASSERT_EQUALS(all.mean(col), a.mean(col));
+      }
+    }
+    TS_ASSERT_THROWS_ANYTHING(all.merge(csv::Column_Stats(2)));
+    TS_ASSERT_THROWS_ANYTHING(all.merge(csv::Column_Stats(3, true)));
+  }
+
+  void test_large_integers(){
+    // Beyond 2^53, doubles would lose the 1s or keep them, depending on the order of rows
+    std::vector<const char*> lines = {"9007199254740993\n", "1\n", "-9007199254740992\n", "1\n"};
+    for(size_t split=0;split<=lines.size();split++){
+      csv::Column_Stats a(1), b(1);
+      for(size_t i=0;i<lines.size();i++) add_line(i < split ? a : b, lines[i]);
+      b.merge(a);
+      TS_ASSERT_EQUALS("0.75", b.mean(0));
+    }
+  }
+
+  void test_approx(){
+    csv::Column_Stats stats(2, true, 2);
+    for(const char* line:{"a,1\n", "b,\n", "a,1\n", "c,2\n", "a,3\n", "c\n"}) add_line(stats, line);
+    TS_ASSERT(stats.approx());
+    TS_ASSERT_EQUALS("3", stats.distinct(0));
+    TS_ASSERT_EQUALS("a:3;c:2", stats.top(0));
+    // Nulls are left out
+    TS_ASSERT_EQUALS("3", stats.distinct(1));
+    TS_ASSERT_EQUALS("1:2;2:1", stats.top(1));
+    TS_ASSERT(!csv::Column_Stats(2).approx());
+  }
+
+  void test_signed_zero(){
+    csv::Column_Stats a(1), b(1);
+    add_line(a, "-0\n");
+    add_line(b, "0.0\n");
+    csv::Column_Stats ab(1), ba(1);
+    ab.merge(a);
+    ab.merge(b);
+    ba.merge(b);
+    ba.merge(a);
+    TS_ASSERT_EQUALS("0", ab.min(0));
+    TS_ASSERT_EQUALS(ab.min(0), ba.min(0));
+    TS_ASSERT_EQUALS(ab.max(0), ba.max(0));
+  }
+};
@@ -0,0 +1,73 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+
+#include <csv/top.hpp>
+
+#include "helpers.hpp"
+
+class Top_Rows_Test : public CxxTest::TestSuite {
+private:
+  std::string joined(const csv::Top_Rows& top){
+    std::string r;
+    for(std::string_view line:top.rows()) r += line;
+    return r;
+  }
+
+  const std::vector<const char*> lines = {"a,3\n", "b,x\n", "c,-1\n", "d,10\n", "e,3\n",
+					  "f\n", "g,2.5\n", "h,3\n", "i,\n"};
+
+public:
+  void test_largest(){
+    csv::Top_Rows top(3, 1);
+    for(size_t i=0;i<lines.size();i++) add_line(top, lines[i], i);
+    TS_ASSERT_EQUALS(3, top.n_rows());
+    // Ties keep their input order
+    TS_ASSERT_EQUALS("d,10\n" "a,3\n" "e,3\n", joined(top));
+  }
+
+  void test_smallest(){
+    csv::Top_Rows top(2, 1, true);
+    for(size_t i=0;i<lines.size();i++) add_line(top, lines[i], i);
+    TS_ASSERT_EQUALS("c,-1\n" "g,2.5\n", joined(top));
+  }
+
+  void test_few_rows(){
+    // Rows that are not numbers are skipped
+    csv::Top_Rows top(10, 1);
+    for(size_t i=0;i<lines.size();i++) add_line(top, lines[i], i);
+    TS_ASSERT_EQUALS("d,10\n" "a,3\n" "e,3\n" "h,3\n" "g,2.5\n" "c,-1\n", joined(top));
+    csv::Top_Rows none(0, 1);
+    for(size_t i=0;i<lines.size();i++) add_line(none, lines[i], i);
+    TS_ASSERT_EQUALS(0, none.n_rows());
+  }
+
+  void test_merge_ties(){
+    // Every row ties with the last one kept; the lowest positions win, whichever part holds them
+    csv::Top_Rows a(2, 1), b(2, 1);
+    add_line(a, "a5,3\n", 5);
+    add_line(a, "a6,3\n", 6);
+    add_line(b, "b1,3\n", 1);
+    add_line(b, "b7,3\n", 7);
+    add_line(b, "b8,4\n", 8);
+    csv::Top_Rows ab(2, 1), ba(2, 1);
+    ab.merge(a);
+    ab.merge(b);
+    ba.merge(b);
+    ba.merge(a);
+    TS_ASSERT_EQUALS("b8,4\n" "b1,3\n", joined(ab));
+    TS_ASSERT_EQUALS(joined(ab), joined(ba));
+    TS_ASSERT_THROWS_ANYTHING(a.merge(csv::Top_Rows(2, 1, true)));
+  }
+
+  void test_merge_fewer(){
+    // A part that kept more rows than the table it is merged into
+    csv::Top_Rows part(10, 1), top(2, 1);
+    for(size_t i=0;i<lines.size();i++) add_line(part, lines[i], i);
+    add_line(top, "z,3\n", lines.size());
+    top.merge(part);
+    TS_ASSERT_EQUALS(2, top.n_rows());
+    TS_ASSERT_EQUALS("d,10\n" "a,3\n", joined(top));
+  }
+};
@@ -0,0 +1,99 @@
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <stdio.h>
+
+#include <csv/uniq.hpp>
+
+#include "helpers.hpp"
+
+class Uniq_Test : public CxxTest::TestSuite {
+private:
+  size_t read_size = 100;
+  std::string path = "./test_resources/uniq.test.csv";
+
+  void write(const std::string& content){
+    FILE* f = fopen(path.c_str(), "w");
+    fputs(content.c_str(), f);
+    fclose(f);
+  }
+
+  // Deduplicates the rows of the file at path that follow its header
+  std::string uniq(const std::vector<size_t>& key_cols, bool exact, bool last, size_t max_memory = 0){
+    auto cbuf = csv::Mmap_Buffer::create(path, read_size);
+    csv::Linescan lscan(',', read_size);
+    lscan.do_scan_header(cbuf->head(), read_size);
+    cbuf->advance_head(lscan.length());
+    return captured([&](FILE* out){
+		      csv::uniq_rows(*cbuf, ',', lscan.crnl(), key_cols, exact, last, max_memory, out);
+		    });
+  }
+
+public:
+  void test_key_set(){
+    bool inserted;
+    csv::Key_Set fingerprints;
+    TS_ASSERT_EQUALS(0, fingerprints.insert(5, "a", inserted));
+    TS_ASSERT(inserted);
+    TS_ASSERT_EQUALS(1, fingerprints.insert(7, "b", inserted));
+    // Keys with the same fingerprint are taken as equal
+    TS_ASSERT_EQUALS(0, fingerprints.insert(5, "c", inserted));
+    TS_ASSERT(!inserted);
+    TS_ASSERT_EQUALS(2, fingerprints.size());
+    TS_ASSERT_EQUALS("", fingerprints.key(0));
+
+    csv::Key_Set exact(true);
+    exact.insert(5, "a", inserted);
+    TS_ASSERT_EQUALS(1, exact.insert(5, "c", inserted));
+    TS_ASSERT(inserted);
+    TS_ASSERT_EQUALS(0, exact.insert(5, "a", inserted));
+    TS_ASSERT(!inserted);
+    TS_ASSERT_EQUALS("c", exact.key(1));
+
+    for(uint64_t h=1;h<1000;h++) fingerprints.insert(h, "", inserted);
+    TS_ASSERT_EQUALS(999, fingerprints.size());
+    TS_ASSERT_EQUALS(5, fingerprints.insert(4, "", inserted));
+    fingerprints.clear();
+    TS_ASSERT_EQUALS(0, fingerprints.size());
+  }
+
+  void test_uniq(){
+    write("k,l,v\n" "a,x,1\n" "b,x,2\n" "a,x,3\n" "a,y,4\n\n" "b,x,5\n" "c,x,6\n");
+    std::string first = "a,x,1\n" "b,x,2\n" "a,y,4\n" "c,x,6\n";
+    std::string last = "a,x,3\n" "a,y,4\n" "b,x,5\n" "c,x,6\n";
+    for(bool exact:{false, true}){
+      // Spilled after every row, or not at all, the rows are the same and in input order
+      for(size_t max_memory:{0, 1}){
+	TS_ASSERT_EQUALS(first, uniq({0, 1}, exact, false, max_memory));
+	TS_ASSERT_EQUALS(last, uniq({0, 1}, exact, true, max_memory));
+	TS_ASSERT_EQUALS("a,x,1\n" "b,x,2\n" "c,x,6\n", uniq({0}, exact, false, max_memory));
+	TS_ASSERT_EQUALS("a,y,4\n" "b,x,5\n" "c,x,6\n", uniq({0}, exact, true, max_memory));
+      }
+    }
+    remove(path.c_str());
+  }
+
+  void test_uniq_spill(){
+    // Spilled once many keys are kept; keys seen before the spill stay deduplicated
+    std::string content = "k,v\n";
+    for(size_t i=0;i<2000;i++) content += std::to_string((i * 7919) % 500) + "," + std::to_string(i) + "\n";
+    write(content);
+    for(bool last:{false, true}){
+      std::string r = uniq({0}, false, last);
+      TS_ASSERT_EQUALS(r, uniq({0}, false, last, 4096));
+      TS_ASSERT_EQUALS(r, uniq({0}, true, last, 4096));
+    }
+    TS_ASSERT_EQUALS(0, uniq({0}, false, false).find("0,0\n419,1\n"));
+    remove(path.c_str());
+  }
+
+  void test_uniq_missing_key_field(){
+    write("k,l\n" "a,1\n" "b\n");
+    TS_ASSERT_THROWS_ANYTHING(uniq({1}, false, false));
+    TS_ASSERT_THROWS_ANYTHING(uniq({1}, true, true, 1));
+    remove(path.c_str());
+  }
+};